@@ -0,0 +1,216 @@
+#include "Combiner.h"
+#include "Profiler.h"
+
+using namespace std;
+
+bool split_range_t::take(size_t& value)
+{
+   uint64_t current = range.load();
+   while (true)
+   {
+      const size_t next = size_t(current & 0xFFFFFFFFu);
+      const size_t end = size_t(current >> 32);
+      if (next >= end)
+         return false;
+      if (range.compare_exchange_weak(current, pack(next + 1, end)))
+      {
+         value = next;
+         return true;
+      }
+   }
+}
+
+template <class RULE>
+void combiner_t<RULE>::combine(gain_table_t<RULE>& gains, const stop_token& stop)
+{
+   if (number_set_size <= 0)
+      return;
+
+   // These are the indices of the triplets to combine.
+   vector<size_t> indices(preset_indices);
+   combination_scorer_t scorer(universe, number_set_size);
+
+   // With all indices preset, there is a single combination, which may hold no new triplet.
+   if (indices.size() >= number_set_size)
+   {
+      if (indices.back() < first_new_triplet)
+         return;
+
+      combine_after(scorer, gains, indices, indices.size(), 0, stop);
+      return;
+   }
+
+   // Each value of the first free index is taken in turn, unless split off.
+   size_t first_changed = 0;
+   size_t value = 0;
+   while (!stop.stop_requested() && first_values.take(value))
+   {
+      indices.resize(preset_indices.size());
+      indices.push_back(value);
+      for (size_t i = indices.size(); i < number_set_size; ++i)
+         indices.push_back(first_value_after(i, indices[i - 1]));
+
+      combine_after(scorer, gains, indices, preset_indices.size() + 1, first_changed, stop);
+      first_changed = preset_indices.size();
+   }
+}
+
+template <class RULE>
+void combiner_t<RULE>::combine_after(combination_scorer_t& scorer, gain_table_t<RULE>& gains, vector<size_t>& indices, size_t fixed_count, size_t first_changed, const stop_token& stop)
+{
+   const phase_scope_t phase(search_phase_t::combiner_enumeration);
+
+   // Tag the pair counting of each combination only while profiling:
+   // even a scope costs a few percent in this loop.
+   const bool is_tagging_counts = is_profiling.load(memory_order_relaxed);
+   const bool is_widening = first_new_triplet > 0;
+
+   bool more_combinations = true;
+   number_set_t number_set(number_set_size);
+   while (more_combinations && !stop.stop_requested())
+   {
+      combination_count++;
+
+      // Combinations that only differ in triplets past the point where
+      // the set got filled give the same number set: improve it only once.
+      if (is_tagging_counts)
+         set_search_phase(search_phase_t::pair_counting);
+      const bool is_new_set = scorer.update(indices, first_changed);
+      if (is_tagging_counts)
+         set_search_phase(search_phase_t::combiner_enumeration);
+
+      if (is_new_set && (!is_widening || !was_searched(indices, scorer.last_used_position())))
+      {
+         number_set.reset();
+         for (size_t i : indices)
+            number_set.add(triplets[i]);
+
+         improver.improve(number_set, scorer.pair_count(), gains, stop);
+      }
+
+      // Generate the next set of indices of triplets. This is N choose K in maths.
+      // This is equal to N! / (K! x (N-K)!). Here N is the number of triplets we found
+      // and K is the desired size of the set of numbers.
+      more_combinations = false;
+      for (size_t which_indice = indices.size() - 1; which_indice != fixed_count - 1; which_indice--)
+      {
+         if (indices[which_indice] + 1 < triplets.size() - (number_set_size - which_indice - 1))
+         {
+            indices[which_indice] += 1;
+            for (size_t reset_indice = which_indice + 1; reset_indice < indices.size(); reset_indice++)
+            {
+               indices[reset_indice] = indices[reset_indice - 1] + 1;
+            }
+
+            // When widening, the last triplet must be a new one.
+            if (is_widening && indices.back() < first_new_triplet)
+               indices.back() = first_new_triplet;
+            first_changed = which_indice;
+            more_combinations = true;
+            break;
+         }
+      }
+   }
+}
+
+template <class RULE>
+bool combiner_t<RULE>::split(size_t& first, size_t& end)
+{
+   // Each value v of the first free index gives C(N - 1 - v, K - 1 - free)
+   // combinations, less the C(F - 1 - v, K - 1 - free) holding no triplet
+   // from the first new one F on. Split where the values after have about
+   // half of them.
+   const size_t free_index = preset_indices.size();
+   auto choose = [](size_t n, size_t k)
+   {
+      double count = 1.;
+      for (size_t i = 0; i < k; ++i)
+         count = n > i ? count * double(n - i) / double(i + 1) : 0.;
+      return count;
+   };
+   auto combinations_for = [this, free_index, &choose](size_t value)
+   {
+      const size_t k = number_set_size - 1 - free_index;
+      const double old_count = first_new_triplet > value + 1 ? choose(first_new_triplet - 1 - value, k) : 0.;
+      return choose(triplets.size() - 1 - value, k) - old_count;
+   };
+
+   auto choose_split = [&combinations_for](size_t next, size_t end)
+   {
+      double total = 0.;
+      for (size_t value = next; value < end; ++value)
+         total += combinations_for(value);
+
+      // The values are in decreasing order of work: take them from the end.
+      double taken = 0.;
+      size_t first = end;
+      while (first > next && taken + combinations_for(first - 1) <= total / 2.)
+      {
+         first -= 1;
+         taken += combinations_for(first);
+      }
+
+      // The last value alone may be more than half: take it anyway, its
+      // owner is busy with another.
+      return first == end ? end - 1 : first;
+   };
+
+   return first_values.split(choose_split, first, end);
+}
+
+template <class RULE>
+vector<combiner_t<RULE>> generate_combiners(const vector<power_triplet_t>& triplets, const triplet_universe_t& universe, const RULE& rule, const size_t number_set_size, size_t levels, const improver_options_t& options, size_t first_new_triplet)
+{
+   vector<combiner_t<RULE>> combiners;
+
+   // Not enough triplets to make a single combination, or no new triplet.
+   if (triplets.size() < number_set_size || first_new_triplet >= triplets.size())
+      return combiners;
+
+   levels = std::min(levels, number_set_size);
+
+   if (levels <= 0)
+   {
+      combiners.push_back(combiner_t<RULE>(triplets, universe, rule, number_set_size, {}, options, first_new_triplet));
+      return combiners;
+   }
+
+   vector<size_t> preset_indices;
+   for (size_t i = 0; i < levels; ++i)
+      preset_indices.push_back(i);
+
+   bool more_combinations = true;
+   while (more_combinations)
+   {
+      // With all indices preset, the last one must be a new triplet.
+      if (levels < number_set_size || preset_indices.back() >= first_new_triplet)
+         combiners.push_back(combiner_t<RULE>(triplets, universe, rule, number_set_size, preset_indices, options, first_new_triplet));
+
+      more_combinations = false;
+      for (size_t which_indice = preset_indices.size() - 1; which_indice != size_t(-1); which_indice--)
+      {
+         if (preset_indices[which_indice] + 1 < triplets.size() - (number_set_size - which_indice - 1))
+         {
+            preset_indices[which_indice] += 1;
+            for (size_t reset_indice = which_indice + 1; reset_indice < preset_indices.size(); reset_indice++)
+            {
+               preset_indices[reset_indice] = preset_indices[reset_indice - 1] + 1;
+            }
+            more_combinations = true;
+            break;
+         }
+      }
+   }
+
+   return combiners;
+}
+
+template struct combiner_t<power_of_two_rule_t>;
+template struct combiner_t<power_of_two_difference_rule_t>;
+template struct combiner_t<listed_sum_rule_t>;
+template struct combiner_t<listed_difference_rule_t>;
+
+template vector<combiner_t<power_of_two_rule_t>> generate_combiners(const vector<power_triplet_t>&, const triplet_universe_t&, const power_of_two_rule_t&, const size_t, size_t, const improver_options_t&, size_t);
+template vector<combiner_t<power_of_two_difference_rule_t>> generate_combiners(const vector<power_triplet_t>&, const triplet_universe_t&, const power_of_two_difference_rule_t&, const size_t, size_t, const improver_options_t&, size_t);
+template vector<combiner_t<listed_sum_rule_t>> generate_combiners(const vector<power_triplet_t>&, const triplet_universe_t&, const listed_sum_rule_t&, const size_t, size_t, const improver_options_t&, size_t);
+template vector<combiner_t<listed_difference_rule_t>> generate_combiners(const vector<power_triplet_t>&, const triplet_universe_t&, const listed_difference_rule_t&, const size_t, size_t, const improver_options_t&, size_t);
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Improver.h"
+#include "TripletUniverse.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stop_token>
+#include <vector>
+
+// Values [next, end) still to be taken by an index of the combinations.
+// The owner takes values from the front while idle threads split off
+// the back, both with a single atomic operation.
+struct split_range_t
+{
+   split_range_t(size_t first = 0, size_t end = 0) : range(pack(first, end)) {}
+
+   // Only copied before any thread uses the range.
+   split_range_t(const split_range_t& other) : range(other.range.load()) {}
+
+   // Take the next value, returns false when none remain.
+   bool take(size_t& value);
+
+   // Split off the values from the given one to the end, chosen by the
+   // function from the values remaining. Returns false when none remain
+   // or the function returns the end.
+   template <class CHOOSE>
+   bool split(CHOOSE&& choose_split, size_t& first, size_t& end)
+   {
+      uint64_t current = range.load();
+      while (true)
+      {
+         const size_t next = size_t(current & 0xFFFFFFFFu);
+         end = size_t(current >> 32);
+         if (next >= end)
+            return false;
+         first = choose_split(next, end);
+         if (first >= end)
+            return false;
+         if (range.compare_exchange_weak(current, pack(next, first)))
+            return true;
+      }
+   }
+
+   size_t remaining() const
+   {
+      const uint64_t current = range.load();
+      const size_t next = size_t(current & 0xFFFFFFFFu);
+      const size_t end = size_t(current >> 32);
+      return next < end ? end - next : 0;
+   }
+
+private:
+   static uint64_t pack(size_t next, size_t end) { return uint64_t(next) | (uint64_t(end) << 32); }
+
+   std::atomic<uint64_t> range;
+};
+
+// Generate a subset all combinations of triplets (i.e N choose K)
+// and keep the best resulting combination.
+// Hold its own state so that multiple can run in parallel in multiple
+// threads.
+//
+// The first index after the preset ones goes through a range of values
+// that idle threads can split, each part given to a new combiner.
+//
+// When widening the triplets of a previous search, only the combinations
+// holding at least one triplet from first_new_triplet on are generated,
+// and only the number sets using one of them are improved.
+template <class RULE = power_of_two_rule_t>
+struct combiner_t
+{
+   const std::vector<power_triplet_t>& triplets;
+   const triplet_universe_t& universe;
+   const size_t number_set_size;
+   const size_t first_new_triplet;
+   std::vector<size_t> preset_indices;
+   improver_t<RULE> improver;
+   size_t combination_count = 0;
+
+   combiner_t(const std::vector<power_triplet_t>& tris, const triplet_universe_t& universe, const RULE& rule, size_t set_size, std::vector<size_t> preset, const improver_options_t& options = {}, size_t first_new = 0)
+      : triplets(tris)
+      , universe(universe)
+      , number_set_size(set_size)
+      , first_new_triplet(first_new)
+      , preset_indices(preset)
+      , improver(rule, set_size, options)
+      , first_values(first_free_value(), end_of_free_values())
+   {}
+
+   // Combiner for the values split off from another one.
+   combiner_t(const combiner_t& other, size_t first, size_t end)
+      : triplets(other.triplets)
+      , universe(other.universe)
+      , number_set_size(other.number_set_size)
+      , first_new_triplet(other.first_new_triplet)
+      , preset_indices(other.preset_indices)
+      , improver(other.improver.rule, other.number_set_size, other.improver.options)
+      , first_values(first, end)
+   {}
+
+   // Improve the number sets of the combinations keeping the pair counts
+   // in the given table, which the combiners run by a thread should share.
+   void combine(gain_table_t<RULE>& gains, const std::stop_token& stop = {});
+
+   // Split off about half of the combinations not yet started, weighted by
+   // the number of combinations each value of the first free index gives.
+   // Returns false when there are none left to split.
+   bool split(size_t& first, size_t& end);
+
+   // Values of the first free index not yet started.
+   size_t remaining_values() const { return first_values.remaining(); }
+
+private:
+   // The last index is the one that must reach the new triplets.
+   size_t first_value_after(size_t index, size_t previous_value) const
+   {
+      const size_t value = index > 0 ? previous_value + 1 : 0;
+      return index + 1 == number_set_size ? std::max(value, first_new_triplet) : value;
+   }
+
+   size_t first_free_value() const
+   {
+      const size_t free_index = preset_indices.size();
+      return first_value_after(free_index, free_index > 0 ? preset_indices.back() : 0);
+   }
+   size_t end_of_free_values() const
+   {
+      const size_t free_index = preset_indices.size();
+      if (free_index >= number_set_size || triplets.size() + free_index + 1 < number_set_size)
+         return 0;
+      return triplets.size() - (number_set_size - free_index - 1);
+   }
+
+   // Whether the number set only uses triplets before the new ones and the
+   // combination could have been completed with them: a previous search
+   // had the same number set.
+   bool was_searched(const std::vector<size_t>& indices, size_t last_used) const
+   {
+      return first_new_triplet > 0 && indices[last_used] + (number_set_size - 1 - last_used) < first_new_triplet;
+   }
+
+   // Combine all triplets after the given fixed indices.
+   void combine_after(combination_scorer_t& scorer, gain_table_t<RULE>& gains, std::vector<size_t>& indices, size_t fixed_count, size_t first_changed, const std::stop_token& stop);
+
+   split_range_t first_values;
+};
+
+// Generate the combiners that together cover all combinations of triplets.
+// Each combiner has its first few triplets (levels) preset.
+// The options are given to the improvers of the combiners. Only the
+// combinations holding a triplet from first_new_triplet on are covered.
+template <class RULE>
+std::vector<combiner_t<RULE>> generate_combiners(const std::vector<power_triplet_t>& triplets, const triplet_universe_t& universe, const RULE& rule, const size_t number_set_size, size_t levels, const improver_options_t& options = {}, size_t first_new_triplet = 0);
@@ -0,0 +1,177 @@
+#include "GainTable.h"
+
+#include <algorithm>
+
+using namespace std;
+
+template <class RULE>
+gain_table_t<RULE>::gain_table_t(const RULE& rule, my_int_t max_magnitude)
+   : rule(rule)
+   , max_magnitude(max_magnitude)
+{
+   for (const my_int_t target : rule.targets.values)
+      max_listed_target = std::max(max_listed_target, target < 0 ? -target : target);
+}
+
+template <class RULE>
+void gain_table_t<RULE>::assign(const number_set_t& number_set)
+{
+   removed_members.clear();
+   for (const my_int_t number : members)
+      if (!number_set.numbers.contains(number))
+         removed_members.push_back(number);
+
+   for (const my_int_t number : removed_members)
+      remove(number);
+
+   for (const my_int_t number : number_set.numbers)
+      if (!is_member(number))
+         add(number);
+}
+
+template <class RULE>
+size_t gain_table_t<RULE>::best_gain()
+{
+   while (best_gain_hint > 0 && (best_gain_hint >= gain_buckets.size() || gain_buckets[best_gain_hint] <= 0))
+      best_gain_hint -= 1;
+   return best_gain_hint;
+}
+
+template <class RULE>
+size_t gain_table_t<RULE>::worst_degree()
+{
+   // Members without pairs are not in the buckets.
+   while (worst_degree_hint < degree_buckets.size() && degree_buckets[worst_degree_hint] <= 0)
+      worst_degree_hint += 1;
+   return worst_degree_hint < degree_buckets.size() ? worst_degree_hint : 0;
+}
+
+template <class RULE>
+void gain_table_t<RULE>::members_of_degree(size_t degree, vector<my_int_t>& numbers) const
+{
+   numbers.clear();
+   for (const my_int_t number : members)
+      if (entries.at(number).pair_count == degree)
+         numbers.push_back(number);
+   sort(numbers.begin(), numbers.end());
+}
+
+template <class RULE>
+void gain_table_t<RULE>::add(my_int_t number)
+{
+   cover_magnitude((number < 0 ? -number : number) + max_listed_target);
+
+   entry_t& entry = entries[number];
+   dequeue(number, entry);
+   entry.is_member = true;
+   enqueue(number, entry);
+   members.push_back(number);
+
+   update_complements(number, targets, true);
+}
+
+template <class RULE>
+void gain_table_t<RULE>::remove(my_int_t number)
+{
+   update_complements(number, targets, false);
+
+   members.erase(find(members.begin(), members.end(), number));
+
+   entry_t& entry = entries[number];
+   dequeue(number, entry);
+   entry.is_member = false;
+   enqueue(number, entry);
+}
+
+template <class RULE>
+void gain_table_t<RULE>::update_complements(my_int_t number, const vector<target_t>& for_targets, bool adding)
+{
+   for (const target_t& target : for_targets)
+   {
+      for (const my_int_t complement : rule.complements(number, target.value))
+      {
+         if (complement == number)
+            continue;
+
+         entry_t& entry = entries[complement];
+         dequeue(complement, entry);
+         if (target.forms_pairs)
+            entry.pair_count = adding ? entry.pair_count + 1 : entry.pair_count - 1;
+         if (target.is_listed)
+            entry.sources = adding ? entry.sources + 1 : entry.sources - 1;
+
+         enqueue(complement, entry);
+      }
+   }
+}
+
+template <class RULE>
+void gain_table_t<RULE>::cover_magnitude(my_int_t magnitude)
+{
+   if (magnitude <= covered_magnitude)
+      return;
+   covered_magnitude = magnitude;
+
+   // Candidates are at most the largest target away from a member,
+   // so the partner targets cover the pairs between them and the members.
+   vector<target_t> covering;
+   for (const my_int_t value : rule.partner_targets(magnitude))
+      covering.push_back({ value, true, false });
+   for (const my_int_t value : rule.targets.values)
+   {
+      auto where = find_if(covering.begin(), covering.end(), [value](const target_t& target) { return target.value == value; });
+      if (where == covering.end())
+         where = covering.insert(covering.end(), { value, false, false });
+      where->is_listed = true;
+   }
+
+   // The current members must also be counted for the new targets.
+   vector<target_t> added;
+   for (const target_t& target : covering)
+      if (none_of(targets.begin(), targets.end(), [&target](const target_t& known) { return known.value == target.value; }))
+         added.push_back(target);
+
+   targets = move(covering);
+   for (const my_int_t member : members)
+      update_complements(member, added, true);
+}
+
+template <class RULE>
+void gain_table_t<RULE>::enqueue(my_int_t number, const entry_t& entry)
+{
+   if (entry.is_member)
+   {
+      if (entry.pair_count <= 0)
+         return;
+      if (degree_buckets.size() <= entry.pair_count)
+         degree_buckets.resize(entry.pair_count + 1);
+      degree_buckets[entry.pair_count] += 1;
+      worst_degree_hint = std::min(worst_degree_hint, entry.pair_count);
+   }
+   else if (is_candidate(number, entry))
+   {
+      if (gain_buckets.size() <= entry.pair_count)
+         gain_buckets.resize(entry.pair_count + 1);
+      gain_buckets[entry.pair_count] += 1;
+      best_gain_hint = std::max(best_gain_hint, entry.pair_count);
+   }
+}
+
+template <class RULE>
+void gain_table_t<RULE>::dequeue(my_int_t number, const entry_t& entry)
+{
+   if (entry.is_member)
+   {
+      if (entry.pair_count > 0)
+         degree_buckets[entry.pair_count] -= 1;
+   }
+   else if (is_candidate(number, entry))
+   {
+      gain_buckets[entry.pair_count] -= 1;
+   }
+}
+
+template struct gain_table_t<power_of_two_rule_t>;
+template struct gain_table_t<power_of_two_difference_rule_t>;
+template struct gain_table_t<listed_sum_rule_t>;
+template struct gain_table_t<listed_difference_rule_t>;
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "PowerPairs.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Pair counts of the members of a number set and of the numbers that
+// could replace one of them, kept up to date as members are added and
+// removed, so that a swap only touches the partners of the two numbers.
+//
+// The degree of a member is the number of other members it forms pairs
+// with. The gain of a candidate, a non-member that is the complement of
+// a member for one of the listed targets, is the number of members it
+// forms pairs with. Both are kept in bucket queues, so the best gain and
+// the worst non-zero degree are found without scanning.
+//
+// Numbers that no longer pair with any member keep their empty entries,
+// so that numbers coming back do not reallocate them.
+//
+// Membership is a flag of the entries, also in the bounded mode: its
+// test comes with the lookup of the pair count, where a separate bitmap
+// of the whole range would take a cache miss of its own.
+template <class RULE = power_of_two_rule_t>
+struct gain_table_t
+{
+   // A non-zero max_magnitude excludes candidates outside [-max_magnitude, max_magnitude].
+   gain_table_t(const RULE& rule, my_int_t max_magnitude = 0);
+
+   // Make the members those of the number set, only adding and removing the differences.
+   void assign(const number_set_t& number_set);
+
+   bool is_member(my_int_t number) const
+   {
+      const auto where = entries.find(number);
+      return where != entries.end() && where->second.is_member;
+   }
+
+   // Number of members forming a pair with the number, itself excluded.
+   size_t pair_count(my_int_t number) const
+   {
+      const auto where = entries.find(number);
+      return where != entries.end() ? where->second.pair_count : 0;
+   }
+
+   // Largest gain of the candidates, zero when there are none.
+   size_t best_gain();
+
+   // Smallest non-zero degree of the members, zero when no member has any pair.
+   size_t worst_degree();
+
+   // Fill with the members of the given degree, in increasing order.
+   void members_of_degree(size_t degree, std::vector<my_int_t>& numbers) const;
+
+private:
+   struct entry_t
+   {
+      size_t pair_count = 0;
+
+      // How many times the number is the complement of a member for a listed target.
+      size_t sources = 0;
+
+      bool is_member = false;
+   };
+
+   struct target_t
+   {
+      my_int_t value = 0;
+      bool forms_pairs = false;
+      bool is_listed = false;
+   };
+
+   void add(my_int_t number);
+   void remove(my_int_t number);
+
+   // Count or uncount the number in the entries of its complements for the given targets.
+   void update_complements(my_int_t number, const std::vector<target_t>& for_targets, bool adding);
+
+   // Make the targets cover the pairs of members and candidates up to the given magnitude.
+   void cover_magnitude(my_int_t magnitude);
+
+   bool is_candidate(my_int_t number, const entry_t& entry) const
+   {
+      return !entry.is_member && entry.sources > 0 && (max_magnitude <= 0 || (number >= -max_magnitude && number <= max_magnitude));
+   }
+
+   void enqueue(my_int_t number, const entry_t& entry);
+   void dequeue(my_int_t number, const entry_t& entry);
+
+   const RULE& rule;
+   const my_int_t max_magnitude;
+   my_int_t max_listed_target = 0;
+   my_int_t covered_magnitude = -1;
+
+   std::vector<target_t> targets;
+   std::unordered_map<my_int_t, entry_t> entries;
+   std::vector<my_int_t> members;
+   std::vector<my_int_t> removed_members;
+
+   // Number of candidates per gain and of members per degree.
+   std::vector<size_t> gain_buckets;
+   std::vector<size_t> degree_buckets;
+
+   // Bounds on the best gain and worst degree, tightened when queried.
+   size_t best_gain_hint = 0;
+   size_t worst_degree_hint = 0;
+};
@@ -0,0 +1,192 @@
+#include "Improver.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+using namespace std;
+
+template <class RULE>
+void improver_t<RULE>::improve(const number_set_t& number_set, size_t pair_count, const stop_token& stop)
+{
+   if (!own_gains)
+      own_gains = make_unique<gain_table_t<RULE>>(rule, options.max_magnitude);
+   improve(number_set, pair_count, *own_gains, stop);
+}
+
+template <class RULE>
+void improver_t<RULE>::improve(const number_set_t& number_set, size_t pair_count, gain_table_t<RULE>& gain_table, const stop_token& stop)
+{
+   const phase_scope_t phase(search_phase_t::improver);
+
+   number_sets_to_improve.emplace_back(number_set, pair_count);
+   gains = &gain_table;
+
+   while (number_sets_to_improve.size() > 0)
+   {
+      if (stop.stop_requested())
+      {
+         number_sets_to_improve.clear();
+         break;
+      }
+
+      auto [number_set, pair_count] = move(number_sets_to_improve.back());
+      number_sets_to_improve.pop_back();
+      expansion_count += 1;
+      update_best_number_set(number_set, pair_count);
+
+      // Usually a single swap away from the previous number set.
+      gains->assign(number_set);
+      improve_number_set(number_set, pair_count);
+   }
+
+   gains = nullptr;
+}
+
+template <class RULE>
+void improver_t<RULE>::update_best_number_set(const number_set_t& number_set, size_t pair_count)
+{
+   const bool is_better = options.deterministic
+      ? is_canonically_better(number_set, pair_count, best_number_set, best_pair_count, RULE::can_simplify)
+      : pair_count > best_pair_count;
+   if (is_better)
+   {
+      best_number_set = number_set;
+      best_pair_count = pair_count;
+      if (on_better)
+         on_better(best_number_set, best_pair_count);
+   }
+}
+
+template <class RULE>
+void improver_t<RULE>::new_improve_number_set(const number_set_t& number_set, size_t pair_count)
+{
+   // Find best numbers to add to the set.
+   pair_count_per_numbers.clear();
+   for (const my_int_t target : rule.targets.values)
+      for (const my_int_t number : number_set.numbers)
+         for (const my_int_t maybe_number : rule.complements(number, target))
+            pair_count_per_numbers[maybe_number] += 1;
+
+   size_t better_pair_count = 0;
+   for (const auto& [number, count] : pair_count_per_numbers)
+   {
+      if (!is_allowed(number) || is_member(number))
+         continue;
+
+      if (count > better_pair_count)
+      {
+         better_numbers.resize(0);
+         better_numbers.push_back(number);
+         better_pair_count = count;
+      }
+      else if (count == better_pair_count)
+      {
+         better_numbers.push_back(number);
+      }
+   }
+
+   // Find worst current numbers to replace.
+   pair_count_per_numbers.clear();
+   for (const power_pair_t& pair : number_set.generate_pairs(rule))
+   {
+      pair_count_per_numbers[pair.a] += 1;
+      pair_count_per_numbers[pair.b] += 1;
+   }
+
+   size_t worst_pair_count = 1000000;
+   for (const auto& [number, count] : pair_count_per_numbers)
+   {
+      if (count < worst_pair_count)
+      {
+         worst_numbers.resize(0);
+         worst_numbers.push_back(number);
+         worst_pair_count = count;
+      }
+      else if (count == worst_pair_count)
+      {
+         worst_numbers.push_back(number);
+      }
+   }
+
+   // Verify if the best is better than the worst.
+   if (better_pair_count <= worst_pair_count)
+      return;
+
+   for (const my_int_t better_number : better_numbers)
+   {
+      for (const my_int_t worst_number : worst_numbers)
+      {
+         number_set_t improved(number_set);
+         improved.numbers.erase(worst_number);
+         improved.numbers.insert(better_number);
+         const size_t improved_pair_count = improved.count_pairs(rule);
+         if (improved_pair_count > pair_count)
+         {
+            improved.improvement_count += 1;
+            improvement_count += 1;
+            number_sets_to_improve.emplace_back(move(improved), improved_pair_count);
+         }
+      }
+   }
+}
+
+template <class RULE>
+void improver_t<RULE>::improve_number_set(const number_set_t& number_set, size_t pair_count)
+{
+   // No candidate forms more pairs than the worst member: no swap can improve the set.
+   const size_t worst_pair_count = gains->worst_degree();
+   if (gains->best_gain() <= worst_pair_count)
+      return;
+
+   current_numbers.assign(number_set.numbers.begin(), number_set.numbers.end());
+   if (options.deterministic)
+      sort(current_numbers.begin(), current_numbers.end());
+
+   // Without any pair, as happens with some targets, every number is the worst.
+   if (worst_pair_count <= 0)
+      worst_numbers.assign(current_numbers.begin(), current_numbers.end());
+   else
+      gains->members_of_degree(worst_pair_count, worst_numbers);
+
+   for (const my_int_t target : rule.targets.values)
+   {
+      for (const my_int_t number : current_numbers)
+      {
+         for (const my_int_t maybe_number : rule.complements(number, target))
+         {
+            if (!is_allowed(maybe_number) || is_member(maybe_number))
+               continue;
+
+            // Pairs the candidate would form with the whole set. The worst
+            // number it replaces only takes away its pair with the candidate.
+            const size_t candidate_pair_count = gains->pair_count(maybe_number);
+            if (candidate_pair_count <= worst_pair_count)
+               continue;
+
+            for (const my_int_t worst_number : worst_numbers)
+            {
+               const size_t maybe_pair_count = candidate_pair_count - (rule.is_pair(worst_number, maybe_number) ? 1 : 0);
+
+               if (maybe_pair_count > worst_pair_count)
+               {
+                  number_set_t improved(number_set);
+                  improved.numbers.erase(worst_number);
+                  improved.numbers.insert(maybe_number);
+                  improved.improvement_count += 1;
+                  improvement_count += 1;
+
+                  // The worst number took its pairs with it, the new one brings its own.
+                  const size_t improved_pair_count = pair_count - worst_pair_count + maybe_pair_count;
+                  number_sets_to_improve.emplace_back(move(improved), improved_pair_count);
+                  return;
+               }
+            }
+         }
+      }
+   }
+}
+
+template struct improver_t<power_of_two_rule_t>;
+template struct improver_t<power_of_two_difference_rule_t>;
+template struct improver_t<listed_sum_rule_t>;
+template struct improver_t<listed_difference_rule_t>;
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "GainTable.h"
+#include "PowerPairs.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+// Options of the improvers, shared by all combiners of a search.
+struct improver_options_t
+{
+   // A non-zero max_magnitude restricts added numbers to [-max_magnitude, max_magnitude].
+   my_int_t max_magnitude = 0;
+
+   // Explore numbers in increasing order and break ties between equally
+   // good number sets canonically, so results do not depend on hashing.
+   bool deterministic = false;
+};
+
+// Improve a number set, generating other number sets.
+// Keep only the best number set.
+// The rule tells which numbers form pairs and gives the candidate complements.
+template <class RULE = power_of_two_rule_t>
+struct improver_t
+{
+   const RULE& rule;
+   const improver_options_t options;
+   number_set_t best_number_set;
+   size_t best_pair_count = 0;
+   size_t improvement_count = 0;
+
+   // Number sets taken from the work list to be improved.
+   size_t expansion_count = 0;
+
+   // Optionally called each time the best number set improves,
+   // from the thread running the improver.
+   std::function<void(const number_set_t&, size_t)> on_better;
+
+   improver_t(const RULE& rule, const size_t set_size, const improver_options_t& options = {})
+      : rule(rule), options(options), best_number_set(set_size) {}
+
+   // Improve the number set, which has the given number of pairs.
+   void improve(const number_set_t& number_set, size_t pair_count, const std::stop_token& stop = {});
+   void improve(const number_set_t& number_set, const std::stop_token& stop = {}) { improve(number_set, number_set.count_pairs(rule), stop); }
+
+   // Improve the number set keeping the pair counts in the given table,
+   // built for the same rule and options. Successive number sets share
+   // most of their numbers, so a thread running many improvers should
+   // give them all the same table: only the differences get updated.
+   void improve(const number_set_t& number_set, size_t pair_count, gain_table_t<RULE>& gains, const std::stop_token& stop = {});
+
+private:
+   std::vector<my_int_t> better_numbers;
+   std::vector<my_int_t> worst_numbers;
+   std::vector<std::pair<number_set_t, size_t>> number_sets_to_improve;
+   std::map<my_int_t, size_t> pair_count_per_numbers;
+
+   // Numbers of the set being improved, in exploration order.
+   std::vector<my_int_t> current_numbers;
+
+   // Pair counts of the members of the number set being improved and of
+   // the numbers that could replace them, updated with each swap.
+   // Given to improve() or, when not, owned by the improver.
+   gain_table_t<RULE>* gains = nullptr;
+   std::unique_ptr<gain_table_t<RULE>> own_gains;
+
+   bool is_member(my_int_t number) const
+   {
+      return gains->is_member(number);
+   }
+
+   bool is_allowed(my_int_t number) const
+   {
+      return options.max_magnitude <= 0 || (number >= -options.max_magnitude && number <= options.max_magnitude);
+   }
+
+   void update_best_number_set(const number_set_t& number_set, size_t pair_count);
+   void new_improve_number_set(const number_set_t& number_set, size_t pair_count);
+   void improve_number_set(const number_set_t& number_set, size_t pair_count);
+};
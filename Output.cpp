@@ -0,0 +1,118 @@
+#include "Output.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+buffered_writer_t::buffered_writer_t(FILE* file, size_t buffer_size)
+   : file(file)
+   , buffer(std::max(buffer_size, size_t(64)))
+{
+}
+
+buffered_writer_t::~buffered_writer_t()
+{
+   flush();
+}
+
+char* buffered_writer_t::reserve(size_t size)
+{
+   if (used + size > buffer.size())
+      flush();
+   if (size > buffer.size())
+      buffer.resize(size);
+   return buffer.data() + used;
+}
+
+void buffered_writer_t::write_bytes(const void* data, size_t size)
+{
+   memcpy(reserve(size), data, size);
+   used += size;
+}
+
+buffered_writer_t& buffered_writer_t::operator<<(string_view text)
+{
+   write_bytes(text.data(), text.size());
+   return *this;
+}
+
+buffered_writer_t& buffered_writer_t::operator<<(char c)
+{
+   *reserve(1) = c;
+   used += 1;
+   return *this;
+}
+
+buffered_writer_t& buffered_writer_t::operator<<(my_int_t number)
+{
+   // Enough for any 64-bit integer with its sign.
+   constexpr size_t max_digits = 21;
+   char* start = reserve(max_digits);
+   used += size_t(to_chars(start, start + max_digits, number).ptr - start);
+   return *this;
+}
+
+buffered_writer_t& buffered_writer_t::operator<<(size_t number)
+{
+   constexpr size_t max_digits = 21;
+   char* start = reserve(max_digits);
+   used += size_t(to_chars(start, start + max_digits, number).ptr - start);
+   return *this;
+}
+
+buffered_writer_t& buffered_writer_t::operator<<(chrono::seconds duration)
+{
+   return *this << my_int_t(duration.count()) << 's';
+}
+
+void buffered_writer_t::flush()
+{
+   if (used > 0)
+      fwrite(buffer.data(), 1, used, file);
+   used = 0;
+   fflush(file);
+}
+
+namespace
+{
+   // Open a file to write bytes, returns null on failure.
+   FILE* open_binary_file(const string& file_name)
+   {
+#ifdef _WIN32
+      FILE* file = nullptr;
+      if (fopen_s(&file, file_name.c_str(), "wb") != 0)
+         return nullptr;
+      return file;
+#else
+      return fopen(file_name.c_str(), "wb");
+#endif
+   }
+}
+
+binary_result_writer_t::binary_result_writer_t(const string& file_name)
+   : file(open_binary_file(file_name))
+{
+   if (!file)
+      throw runtime_error("Cannot write the binary file " + file_name + ".");
+
+   writer = make_unique<buffered_writer_t>(file);
+   writer->write_bytes("P2PR", 4);
+   writer->write_little_endian(uint32_t(1));
+}
+
+binary_result_writer_t::~binary_result_writer_t()
+{
+   writer.reset();
+   fclose(file);
+}
+
+void binary_result_writer_t::write_numbers(const vector<my_int_t>& numbers, size_t pair_count)
+{
+   writer->write_little_endian(uint64_t(numbers.size()));
+   writer->write_little_endian(uint64_t(pair_count));
+   for (const my_int_t number : numbers)
+      writer->write_little_endian(number);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "PowerPairs.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Buffered text output to a C file, with fast integer formatting.
+//
+// Text is only guaranteed to reach the file once flushed, which
+// the destructor does. Nothing is flushed at line ends.
+struct buffered_writer_t
+{
+   buffered_writer_t(std::FILE* file, size_t buffer_size = size_t(1) << 20);
+   ~buffered_writer_t();
+
+   buffered_writer_t& operator<<(std::string_view text);
+   buffered_writer_t& operator<<(char c);
+   buffered_writer_t& operator<<(my_int_t number);
+   buffered_writer_t& operator<<(size_t number);
+   buffered_writer_t& operator<<(std::chrono::seconds duration);
+
+   // Write raw bytes, used by binary output.
+   void write_bytes(const void* data, size_t size);
+
+   // Write an integer in little-endian byte order.
+   template <class T>
+   void write_little_endian(T value)
+   {
+      unsigned char bytes[sizeof(T)];
+      for (size_t i = 0; i < sizeof(T); ++i)
+         bytes[i] = (unsigned char)((uint64_t(value) >> (8 * i)) & 0xFF);
+      write_bytes(bytes, sizeof(T));
+   }
+
+   void flush();
+
+private:
+   // Make room for the given number of bytes in the buffer.
+   char* reserve(size_t size);
+
+   std::FILE* file;
+   std::vector<char> buffer;
+   size_t used = 0;
+};
+
+// Compact binary output of number sets and their pairs.
+//
+// All values are little-endian. The file starts with the magic "P2PR"
+// and a uint32 version, 1. Each result follows: the uint64 set size,
+// the uint64 pair count, the int64 numbers in increasing order, then
+// for each pair the uint32 indices of its two members in the numbers.
+struct binary_result_writer_t
+{
+   binary_result_writer_t(const std::string& file_name);
+   ~binary_result_writer_t();
+
+   // Start a result with its numbers, in increasing order, and how many pairs will follow.
+   void write_numbers(const std::vector<my_int_t>& numbers, size_t pair_count);
+
+   void write_pair(size_t first_index, size_t second_index)
+   {
+      writer->write_little_endian(uint32_t(first_index));
+      writer->write_little_endian(uint32_t(second_index));
+   }
+
+private:
+   std::FILE* file = nullptr;
+   std::unique_ptr<buffered_writer_t> writer;
+};
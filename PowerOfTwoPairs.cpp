@@ -1,676 +1,400 @@
+#include "Output.h"
+#include "Profiler.h"
+#include "Regression.h"
+#include "Scaling.h"
+#include "Search.h"
+#include "Server.h"
+#include "SharedBest.h"
+#include "Trace.h"
 #include "Utilities.h"
+#include "Widening.h"
 
 #include <algorithm>
-#include <compare>
 #include <exception>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
-#include <map>
-#include <set>
-#include <thread>
-#include <unordered_set>
-#include <utility>
+#include <memory>
 #include <vector>
 
 using namespace std;
 
-// Allow changing integer types in case we ever get to use large powers of two.
-using my_int_t = int64_t;
-
-// Pair of numbers summing to a power of two.
-// Can be compared and thus used in sets, etc.
-struct power_pair_t
+// Print the numbers and their pairs, streaming the pairs without building
+// their list. When summary_only, only print the size and the pair count.
+void print_result(const duration_t& duration, const search_config_t& config, const search_result_t& result, bool summary_only)
 {
-   my_int_t a, b;
-
-   power_pair_t(my_int_t i, my_int_t j)
-   {
-      a = std::min({ i, j });
-      b = std::max({ i, j });
-   }
-
-   my_int_t sum() const { return a + b; }
-
-   auto operator<=>(const power_pair_t&) const = default;
-};
+   buffered_writer_t out(stdout);
 
-// Triplets of numbers that all mutually pair-wise sum to powers of two.
-// Can be compared and thus used in sets, etc.
-// Can be checked for overlap with another triplet.
-struct power_triplet_t
-{
-   my_int_t a, b, c;
+   // The pairs are listed in the order of the set, the numbers in increasing order.
+   const number_set_t& number_set = result.best_number_set;
+   const vector<my_int_t> numbers(number_set.numbers.begin(), number_set.numbers.end());
+   const size_t pair_count = result.pair_count;
+   const char* const pairs_name = config.targets == target_kind_t::powers_of_two ? " powers pairs" : " pairs";
 
-   power_triplet_t(my_int_t i, my_int_t j, my_int_t k)
+   if (summary_only)
    {
-      a = std::min({ i, j, k });
-      c = std::max({ i, j, k });
-      b = i + j + k - a - c;
+      out << number_set.desired_size << " numbers in " << duration.elapsed() << ": " << pair_count << pairs_name << "\n";
+      return;
    }
 
-   bool overlaps(const power_triplet_t& other) const
-   {
-      if (*this == other)
-         return false;
-
-      return
-         (a == other.a) ||
-         (a == other.b) ||
-         (a == other.c) ||
-         (b == other.a) ||
-         (b == other.b) ||
-         (b == other.c) ||
-         (c == other.a) ||
-         (c == other.b) ||
-         (c == other.c);
-   }
+   vector<my_int_t> sorted_numbers(numbers);
+   sort(sorted_numbers.begin(), sorted_numbers.end());
+   out << number_set.desired_size << " numbers in " << duration.elapsed() << ":";
+   for (const my_int_t number : sorted_numbers)
+      out << ' ' << number;
+   out << '\n';
 
-   my_int_t count_overlaps(const power_triplet_t& other) const
+   out << pair_count << pairs_name << ":";
+   for_each_pair(config, numbers, [&](size_t i, size_t j)
    {
-      my_int_t count =
-         my_int_t(a == other.a) +
-         my_int_t(a == other.b) +
-         my_int_t(a == other.c) +
-         my_int_t(b == other.a) +
-         my_int_t(b == other.b) +
-         my_int_t(b == other.c) +
-         my_int_t(c == other.a) +
-         my_int_t(c == other.b) +
-         my_int_t(c == other.c);
-
-      return count == 3 ? 0 : count;
-   }
-
-   auto operator<=>(const power_triplet_t&) const = default;
-};
-
+      const power_pair_t pair(numbers[i], numbers[j]);
+      if (config.use_differences)
+         out << ' ' << pair.b << '-' << pair.a << '=' << pair.difference();
+      else
+         out << ' ' << pair.a << '+' << pair.b << '=' << pair.sum();
+   });
+   out << '\n';
+}
 
-// Set of powers of two, for quick check that a sum is such a power.
-unordered_set<my_int_t> gen_powers_of_two(const my_int_t max_power)
+// Write the numbers, in increasing order, and their pairs to the binary output.
+void write_binary_result(binary_result_writer_t& binary, const search_config_t& config, const search_result_t& result)
 {
-   unordered_set<my_int_t> p2;
-   for (my_int_t pow = 0; pow <= max_power; ++pow)
-      p2.insert(my_int_t(1) << pow);
-   return p2;
+   vector<my_int_t> numbers(result.best_number_set.numbers.begin(), result.best_number_set.numbers.end());
+   sort(numbers.begin(), numbers.end());
+   binary.write_numbers(numbers, result.pair_count);
+   for_each_pair(config, numbers, [&](size_t i, size_t j) { binary.write_pair(i, j); });
 }
 
-unordered_set<my_int_t> powers_of_two;
+// Show progression of search.
+void print_progress(const search_progress_t& progress, size_t& current_percent)
+{
+   const size_t percent = 100 * progress.done_combiners / std::max(progress.total_combiners, size_t(1));
+   if (percent == current_percent)
+      return;
 
-bool is_power_of_two(my_int_t number) { return number != 0 && (number & (number - 1)) == 0; }
+   current_percent = percent;
+   std::cout << setw(3) << percent << "% " << setw(5) << progress.elapsed << " " << progress.best_pair_count << " pairs " << progress.max_improvement_count << " improvements\r";
+   std::cout.flush();
+}
 
-// Generate triplets of numbers all pair-wise summing to powers of two.
-vector<power_triplet_t> generate_power_triplets(const size_t triplet_count)
+// Parameters of the program.
+struct parameters_t : command_line_data_t
 {
-   duration_t duration;
-
-   set<power_triplet_t> triplet_set;
+   bool use_simplified_algo = false;
+   size_t min_set_size = 5;
+   size_t max_set_size = 5;
+   size_t triplet_count = 20;
+   size_t combiner_levels = 5;
+   size_t thread_count = 0;
+   my_int_t max_power_of_two = 9;
+   my_int_t max_magnitude = 0;
+   bool deterministic = false;
+   bool use_differences = false;
+   string targets = "2";
+   string server_socket;
+   string baseline;
+   size_t tolerance_percent = 20;
+   bool update_baseline = false;
+   bool scaling_study = false;
+   size_t repetitions = 3;
+   string trace_file;
+   bool summary_only = false;
+   string binary_file;
+   string shared_memory;
+   string profile_file;
+   bool learn_seed_order = false;
+   size_t widen_step = 0;
+   string checkpoint_file;
 
-   my_int_t delta = 0;
-   while (triplet_set.size() < triplet_count)
+   parameters_t()
    {
-      delta += 1;
-      for (my_int_t p2 : powers_of_two)
-      {
-         my_int_t deltas[] = { delta, -delta };
-         for (my_int_t delta : deltas)
-         {
-            const my_int_t i = delta;
-            const my_int_t j = p2 - i;
-            if (i == j)
-               continue;
-
-            for (my_int_t k = -delta; k <= delta; ++k)
-            {
-               if (k == 0 || k == i || k == j)
-                  continue;
-
-               if (is_power_of_two(i + k) && is_power_of_two(j + k))
-               {
-                  triplet_set.emplace(i, j, k);
-               }
-            }
-         }
-      }
+      validate();
    }
 
-   vector<power_triplet_t> triplets;
-   for (const auto& tri : triplet_set)
-      triplets.push_back(tri);
-
-   rotate(triplets.begin(), triplets.begin() + triplets.size() * 3 / 5, triplets.end());
-
-   std::cout << triplets.size() << " triplets in " << duration.elapsed() << "." << endl;
+   void validate() override
+   {
+      min_set_size = std::max(min_set_size, size_t(3));
+      max_set_size = std::max(max_set_size, min_set_size);
+      triplet_count = std::max(triplet_count, min_set_size / 2);
+      triplet_count = std::max(triplet_count, size_t(5));
+      combiner_levels = std::max(combiner_levels, size_t(2));
+      max_power_of_two = std::max(max_power_of_two, my_int_t(5));
+      max_magnitude = std::clamp(max_magnitude, my_int_t(0), max_supported_magnitude);
+   }
+};
 
-   //for (const auto& tri : triplets)
-   //	std::cout << tri.a << " " << tri.b << " " << tri.c << endl;
+// Concrete list of parameters.
+const vector<command_line_arg_t> command_line_args =
+{
+   { "use simpler algorithm",   "s", "simplified", nullptr, nullptr, make_arg(&parameters_t::use_simplified_algo) },
+   { "number of triplets",      "t", "triplets",   make_arg(&parameters_t::triplet_count), nullptr, nullptr		   },
+   { "combiner levels",         "c", "levels",     make_arg(&parameters_t::combiner_levels), nullptr, nullptr	   },
+   { "minimum number-set size", "m", "min",        make_arg(&parameters_t::min_set_size), nullptr, nullptr		   },
+   { "maximum number-set size", "x", "max",        make_arg(&parameters_t::max_set_size), nullptr, nullptr		   },
+   { "number of powers of two", "p", "powers",     nullptr, make_arg(&parameters_t::max_power_of_two), nullptr	   },
+   { "max number magnitude",    "r", "range",      nullptr, make_arg(&parameters_t::max_magnitude), nullptr	   },
+   { "deterministic results",   "z", "deterministic", nullptr, nullptr, make_arg(&parameters_t::deterministic) },
+   { "number of threads",       "j", "threads",    make_arg(&parameters_t::thread_count), nullptr, nullptr		   },
+   { "targets: 2, 3, squares or a file", "g", "targets", nullptr, nullptr, nullptr, make_arg(&parameters_t::targets) },
+   { "pairs by difference",     "i", "differences", nullptr, nullptr, make_arg(&parameters_t::use_differences) },
+   { "serve on a Unix socket",  "d", "server",     nullptr, nullptr, nullptr, make_arg(&parameters_t::server_socket)   },
+   { "regression baseline file", "b", "baseline",  nullptr, nullptr, nullptr, make_arg(&parameters_t::baseline)        },
+   { "regression tolerance %",  "o", "tolerance",  make_arg(&parameters_t::tolerance_percent), nullptr, nullptr	   },
+   { "update the baseline",     "u", "update",     nullptr, nullptr, make_arg(&parameters_t::update_baseline)	   },
+   { "thread-scaling study",    "k", "scaling",    nullptr, nullptr, make_arg(&parameters_t::scaling_study)	   },
+   { "repetitions per threads", "n", "repeat",     make_arg(&parameters_t::repetitions), nullptr, nullptr		   },
+   { "trace improvements to",   "l", "trace",      nullptr, nullptr, nullptr, make_arg(&parameters_t::trace_file)      },
+   { "only print the summary",  "q", "summary",    nullptr, nullptr, make_arg(&parameters_t::summary_only)	   },
+   { "binary results to",       "f", "binary",     nullptr, nullptr, nullptr, make_arg(&parameters_t::binary_file)     },
+   { "share bests in memory",   "a", "shared",     nullptr, nullptr, nullptr, make_arg(&parameters_t::shared_memory)   },
+   { "learn combiner order",    "e", "learn",      nullptr, nullptr, make_arg(&parameters_t::learn_seed_order)	   },
+   { "profile phases to",       "y", "profile",    nullptr, nullptr, nullptr, make_arg(&parameters_t::profile_file)    },
+   { "widen triplets by",       "w", "widen",      make_arg(&parameters_t::widen_step), nullptr, nullptr		   },
+   { "widening checkpoint file", "v", "checkpoint", nullptr, nullptr, nullptr, make_arg(&parameters_t::checkpoint_file) },
+};
 
-   return triplets;
+// Read the targets listed in a file, separated by white space.
+vector<my_int_t> read_targets(const string& file_name)
+{
+   ifstream file(file_name);
+   if (!file)
+      throw runtime_error("Cannot open the targets file " + file_name + ".");
+
+   vector<my_int_t> targets;
+   my_int_t target;
+   while (file >> target)
+      targets.push_back(target);
+   if (!file.eof())
+      throw runtime_error("Invalid target in the file " + file_name + ".");
+
+   return targets;
 }
 
-// A set of N numbers (N equal to desired_size) that have many
-// pair-wise sums equal to powers of two.
-//
-// Can be progressively filled with triplets until the desired
-// size is reached.
-//
-// Can generates the full list of pair-wise sums of powers of two
-// that are produced by the set of numbers.
-struct number_set_t
+// Search configuration common to all number-set sizes.
+search_config_t make_search_config(const parameters_t& params)
 {
-   size_t desired_size;
-   size_t improvement_count = 0;
-   unordered_set<my_int_t> numbers;
-
-   number_set_t(size_t size) : desired_size(size) {}
-
-   void reset() { improvement_count = 0; numbers.clear(); }
-
-   bool is_filled() const { return desired_size == numbers.size(); }
-
-   void add(const my_int_t number)
+   search_config_t config;
+   config.triplet_count = params.triplet_count;
+   config.combiner_levels = params.combiner_levels;
+   config.max_power_of_two = params.max_power_of_two;
+   config.use_simplified_algo = params.use_simplified_algo;
+   config.max_magnitude = params.max_magnitude;
+   config.deterministic = params.deterministic;
+   config.use_differences = params.use_differences;
+   config.learn_seed_order = params.learn_seed_order;
+
+   if (params.targets == "2")
    {
-      if (!is_filled())
-         numbers.insert(number);
+      config.targets = target_kind_t::powers_of_two;
    }
-   void add(const power_triplet_t& tri)
+   else if (params.targets == "3")
    {
-      add(tri.a);
-      add(tri.b);
-      add(tri.c);
+      config.targets = target_kind_t::powers_of_three;
    }
-
-   void simplify()
+   else if (params.targets == "squares")
    {
-      while (std::all_of(numbers.begin(), numbers.end(), [](my_int_t number) { return (number % 2) == 0; }))
-      {
-         unordered_set<my_int_t> new_numbers;
-         for (const my_int_t number : numbers)
-            new_numbers.insert(number / my_int_t(2));
-         new_numbers.swap(numbers);
-      }
+      config.targets = target_kind_t::squares;
    }
-
-   size_t count_pairs() const
+   else
    {
-      size_t count = 0;
-      const auto numbers_end = numbers.end();
-      const auto numbers_end_prev = prev(numbers_end);
-      for (auto i1 = numbers.begin(); i1 != numbers_end_prev; ++i1)
-      {
-         for (auto i2 = next(i1); i2 != numbers_end; ++i2)
-         {
-            const my_int_t n1 = *i1;
-            const my_int_t n2 = *i2;
-            if (!is_power_of_two(n1 + n2))
-               continue;
-
-            count += 1;
-         }
-      }
-      return count;
+      config.targets = target_kind_t::listed;
+      config.listed_targets = read_targets(params.targets);
    }
 
-   vector<power_pair_t> generate_pairs() const
-   {
-      vector<power_pair_t> pairs;
-      pairs.reserve(desired_size * 3);
-      const auto numbers_end = numbers.end();
-      const auto numbers_end_prev = prev(numbers_end);
-      for (auto i1 = numbers.begin(); i1 != numbers_end_prev; ++i1)
-      {
-         for (auto i2 = next(i1); i2 != numbers_end; ++i2)
-         {
-            const my_int_t n1 = *i1;
-            const my_int_t n2 = *i2;
-            if (!is_power_of_two(n1 + n2))
-               continue;
-
-            pairs.emplace_back(n1, n2);
-         }
-      }
-      return pairs;
-   }
-};
+   return config;
+}
 
-// Improve a number set, generating other number sets.
-// Keep only the best number set.
-struct improver_t
+// Run the searches of known optima and compare them with the baseline file.
+// A missing baseline file is created, as is a new one when asked to update.
+int run_regression(const parameters_t& params, const search_config_t& config)
 {
-   number_set_t best_number_set;
-   size_t best_pair_count = 0;
-   size_t improvement_count = 0;
+   if (config.targets != target_kind_t::powers_of_two || config.use_differences)
+      throw runtime_error("The known optima are for sums of powers of two.");
 
-   improver_t(const size_t set_size) : best_number_set(set_size) {}
+   const vector<regression_case_t>& cases = known_optima();
+   const vector<regression_timing_t> timings = run_regression_cases(cases, config);
 
-   void improve(const number_set_t& number_set)
-   {
-      number_sets_to_improve.push_back(number_set);
+   for (const regression_timing_t& timing : timings)
+      std::cout << setw(3) << timing.set_size << " numbers, " << setw(3) << timing.triplet_count << " triplets: " << setw(3) << timing.pair_count << " pairs, optimum in "
+                << setw(6) << timing.time_to_optimum.count() << "ms, total " << setw(6) << timing.total_time.count() << "ms" << endl;
 
-      while (number_sets_to_improve.size() > 0)
-      {
-         number_set_t number_set = number_sets_to_improve.back();
-         number_sets_to_improve.pop_back();
-         update_best_number_set(number_set);
-         improve_number_set(number_set);
-      }
-   }
+   const bool has_baseline = !params.update_baseline && ifstream(params.baseline).good();
+   const vector<regression_timing_t> baseline = has_baseline ? read_baseline(params.baseline) : vector<regression_timing_t>();
+   const vector<string> failures = compare_with_baseline(cases, timings, baseline, params.tolerance_percent / 100.);
 
-private:
-   vector<my_int_t> better_numbers;
-   vector<my_int_t> worst_numbers;
-   vector<number_set_t> number_sets_to_improve;
-   map<my_int_t, size_t> pair_count_per_numbers;
+   for (const string& failure : failures)
+      std::cout << "FAILED " << failure << endl;
+   if (failures.size() > 0)
+      return 1;
 
-   void update_best_number_set(const number_set_t& number_set)
+   if (!has_baseline)
    {
-      const auto pair_count = number_set.count_pairs();
-      if (pair_count > best_pair_count)
-      {
-         best_number_set = number_set;
-         best_pair_count = pair_count;
-      }
+      write_baseline(params.baseline, timings);
+      std::cout << "Baseline written to " << params.baseline << "." << endl;
    }
-
-   void new_improve_number_set(const number_set_t& number_set)
+   else
    {
-      // Find best numbers to add to the set.
-      pair_count_per_numbers.clear();
-      for (const my_int_t power : powers_of_two)
+      // Searches of other parameters cannot be timed against the baseline.
+      const size_t unmatched = count_if(timings.begin(), timings.end(), [&baseline](const regression_timing_t& timing)
       {
-         for (const my_int_t number : number_set.numbers)
-         {
-            const my_int_t maybe_number = power - number;
-            pair_count_per_numbers[maybe_number] += 1;
-         }
-      }
-
-      size_t better_pair_count = 0;
-      for (const auto& [number, count] : pair_count_per_numbers)
-      {
-         if (number_set.numbers.contains(number))
-            continue;
-
-         if (count > better_pair_count)
-         {
-            better_numbers.resize(0);
-            better_numbers.push_back(number);
-            better_pair_count = count;
-         }
-         else if (count == better_pair_count)
-         {
-            better_numbers.push_back(number);
-         }
-      }
-
-      // Find worst current numbers to replace.
-      pair_count_per_numbers.clear();
-      for (const power_pair_t& pair : number_set.generate_pairs())
-      {
-         pair_count_per_numbers[pair.a] += 1;
-         pair_count_per_numbers[pair.b] += 1;
-      }
-
-      size_t worst_pair_count = 1000000;
-      for (const auto& [number, count] : pair_count_per_numbers)
-      {
-         if (count < worst_pair_count)
-         {
-            worst_numbers.resize(0);
-            worst_numbers.push_back(number);
-            worst_pair_count = count;
-         }
-         else if (count == worst_pair_count)
-         {
-            worst_numbers.push_back(number);
-         }
-      }
-
-      // Verify if the best is better than the worst.
-      if (better_pair_count <= worst_pair_count)
-         return;
-
-      const size_t pair_count = number_set.count_pairs();
-      for (const my_int_t better_number : better_numbers)
-      {
-         for (const my_int_t worst_number : worst_numbers)
-         {
-            number_set_t improved(number_set);
-            improved.numbers.erase(worst_number);
-            improved.numbers.insert(better_number);
-            if (improved.count_pairs() > pair_count)
-            {
-               improved.improvement_count += 1;
-               improvement_count += 1;
-               number_sets_to_improve.emplace_back(move(improved));
-            }
-         }
-      }
+         return none_of(baseline.begin(), baseline.end(), [&timing](const regression_timing_t& base) { return is_same_search(base, timing); });
+      });
+      if (unmatched > 0)
+         std::cout << "All " << timings.size() << " searches reach their optimum, " << unmatched << " have no baseline with these parameters: update it to time them." << endl;
+      else
+         std::cout << "All " << timings.size() << " searches match the baseline." << endl;
    }
+   return 0;
+}
 
-   void improve_number_set(const number_set_t& number_set)
+// Repeat the search of each set size with 1, 2, 4... threads up
+// to the thread count and show how well the search scales.
+void run_scaling(const parameters_t& params, const search_config_t& common_config)
+{
+   for (size_t number_set_size = params.min_set_size; number_set_size <= params.max_set_size; ++number_set_size)
    {
-      pair_count_per_numbers.clear();
+      search_config_t config = common_config;
+      config.set_size = number_set_size;
 
-      for (const power_pair_t& pair : number_set.generate_pairs())
-      {
-         pair_count_per_numbers[pair.a] += 1;
-         pair_count_per_numbers[pair.b] += 1;
-      }
-
-      size_t worst_pair_count = 1000000;
-      for (const auto& [number, count] : pair_count_per_numbers)
-      {
-         if (count < worst_pair_count)
-         {
-            worst_numbers.resize(0);
-            worst_numbers.push_back(number);
-            worst_pair_count = count;
-         }
-         else if (count == worst_pair_count)
-         {
-            worst_numbers.push_back(number);
-         }
-      }
+      const vector<scaling_point_t> points = run_scaling_study(config, params.thread_count, params.repetitions);
 
-      for (const my_int_t power : powers_of_two)
+      std::cout << number_set_size << " numbers, best of " << std::max(params.repetitions, size_t(1)) << " runs:" << endl;
+      std::cout << "threads    seconds  combinations/s    expansions/s  speedup  efficiency" << endl;
+      for (const scaling_point_t& point : points)
       {
-         for (const my_int_t number : number_set.numbers)
-         {
-            const my_int_t maybe_number = power - number;
-            if (number_set.numbers.contains(maybe_number))
-               continue;
-
-            for (const my_int_t worst_number : worst_numbers)
-            {
-               size_t maybe_pair_count = 0;
-               for (const my_int_t number : number_set.numbers)
-                  if (number != worst_number && is_power_of_two(number + maybe_number))
-                     maybe_pair_count += 1;
-
-               if (maybe_pair_count > worst_pair_count)
-               {
-                  number_set_t improved(number_set);
-                  improved.numbers.erase(worst_number);
-                  improved.numbers.insert(maybe_number);
-                  improved.improvement_count += 1;
-                  improvement_count += 1;
-                  number_sets_to_improve.emplace_back(move(improved));
-                  return;
-               }
-            }
-         }
+         std::cout << setw(7) << point.thread_count
+                   << fixed << setprecision(3) << setw(11) << point.wall_time.count()
+                   << setprecision(0) << setw(16) << point.combinations_per_second()
+                   << setw(16) << point.expansions_per_second()
+                   << setprecision(2) << setw(9) << point.speedup(points.front())
+                   << setw(11) << 100. * point.efficiency(points.front()) << "%"
+                   << defaultfloat << endl;
       }
    }
-};
-
-// Generate a subset all combinations of triplets (i.e N choose K)
-// and keep the best resulting combination.
-// Hold its own state so that multiple can run in parallel in multiple
+}
 
-struct combiner_t
+// Widen the triplets of the search in steps, resuming from the checkpoint
+// of its set size and saving the checkpoints after each step when a
+// checkpoint file is given.
+search_result_t widen_search_with_checkpoints(const parameters_t& params, const search_config_t& config, const search_callbacks_t& callbacks)
 {
-   const vector<power_triplet_t>& triplets;
-   const size_t number_set_size;
-   vector<size_t> preset_indices;
-   improver_t improver;
-   size_t combination_count = 0;
-
-   combiner_t(const vector<power_triplet_t>& tris, size_t set_size, vector<size_t> preset)
-      : triplets(tris)
-      , number_set_size(set_size)
-      , preset_indices(preset)
-      , improver(set_size)
-   {}
-
-   void combine()
-   {
-      if (number_set_size <= 0)
-         return;
-
-      // These are the indices of the triplets to combine.
-      vector<size_t> indices;
-      if (preset_indices.size() > 0)
-         for (size_t preset : preset_indices)
-            indices.push_back(preset);
-      else
-         indices.push_back(0);
-      for (size_t i = indices.size(); i < number_set_size; ++i)
-         indices.push_back(indices[i - 1] + 1);
+   const bool has_file = params.checkpoint_file.size() > 0;
+   vector<widening_checkpoint_t> checkpoints = has_file ? read_checkpoints(params.checkpoint_file, config) : vector<widening_checkpoint_t>();
 
-      bool more_combinations = true;
-      number_set_t number_set(number_set_size);
-      while (more_combinations)
-      {
-         combination_count++;
-         number_set.reset();
-         for (size_t i : indices)
-            number_set.add(triplets[i]);
-
-         improver.improve(number_set);
-
-         // Generate the next set of indices of triplets. This is N choose K in maths.
-         // This is equal to N! / (K! x (N-K)!). Here N is the number of triplets we found
-         // and K is the desired size of the set of numbers.
-         more_combinations = false;
-         for (size_t which_indice = indices.size() - 1; which_indice != preset_indices.size() - 1; which_indice--)
-         {
-            if (indices[which_indice] + 1 < triplets.size() - (number_set_size - which_indice - 1))
-            {
-               indices[which_indice] += 1;
-               for (size_t reset_indice = which_indice + 1; reset_indice < indices.size(); reset_indice++)
-               {
-                  indices[reset_indice] = indices[reset_indice - 1] + 1;
-               }
-               more_combinations = true;
-               break;
-            }
-         }
-      }
+   auto where = find_if(checkpoints.begin(), checkpoints.end(), [&config](const widening_checkpoint_t& checkpoint) { return checkpoint.set_size == config.set_size; });
+   if (where == checkpoints.end())
+   {
+      checkpoints.emplace_back().set_size = config.set_size;
+      where = checkpoints.end() - 1;
    }
+   widening_checkpoint_t& checkpoint = *where;
 
-};
-
-vector<combiner_t> generate_combiners(const vector<power_triplet_t>& triplets, const size_t number_set_size, size_t levels)
-{
-   vector<combiner_t> combiners;
-
-   levels = std::min(levels, number_set_size);
+   if (checkpoint.triplets.size() > 0)
+      std::cout << "Resuming from " << checkpoint.triplets.size() << " triplets and " << checkpoint.pair_count << " pairs." << endl;
 
-   if (levels <= 0)
+   return widen_search(config, params.widen_step, checkpoint, callbacks, [&](const widening_checkpoint_t&)
    {
-      combiners.push_back(combiner_t(triplets, number_set_size, {}));
-      return combiners;
-   }
+      if (has_file)
+         write_checkpoints(params.checkpoint_file, checkpoints, config);
+   });
+}
 
-   vector<size_t> preset_indices;
-   for (size_t i = 0; i < levels; ++i)
-      preset_indices.push_back(i);
+// Run the searches the parameters ask for, returning the exit status.
+int run_searches(const parameters_t& params, const search_config_t& common_config)
+{
+   // Only the searches of each set size trace and write binary results.
+   const bool has_outputs = params.trace_file.size() > 0 || params.binary_file.size() > 0;
+   if (has_outputs && (params.server_socket.size() > 0 || params.scaling_study || params.baseline.size() > 0))
+      throw runtime_error("The trace and binary outputs are not available in the server, scaling and regression modes.");
 
-   bool more_combinations = true;
-   while (more_combinations)
+   if (params.server_socket.size() > 0)
    {
-      combiners.push_back(combiner_t(triplets, number_set_size, preset_indices));
-
-      more_combinations = false;
-      for (size_t which_indice = preset_indices.size() - 1; which_indice != size_t(-1); which_indice--)
-      {
-         if (preset_indices[which_indice] + 1 < triplets.size() - (number_set_size - which_indice - 1))
-         {
-            preset_indices[which_indice] += 1;
-            for (size_t reset_indice = which_indice + 1; reset_indice < preset_indices.size(); reset_indice++)
-            {
-               preset_indices[reset_indice] = preset_indices[reset_indice - 1] + 1;
-            }
-            more_combinations = true;
-            break;
-         }
-      }
+      server_config_t config;
+      config.socket_path = params.server_socket;
+      config.thread_count = params.thread_count;
+      config.search = common_config;
+      run_server(config);
+      return 0;
    }
 
-   return combiners;
-}
+   simple_thread_pool_t thread_pool(params.thread_count);
 
-// Run the combiners in multiple threads and return the best result.
-number_set_t run_combiners_in_threads(vector<combiner_t>& combiners)
-{
-   if (combiners.size() <= 0)
-      return number_set_t(0);
+   unique_ptr<binary_result_writer_t> binary;
+   if (params.binary_file.size() > 0)
+      binary = make_unique<binary_result_writer_t>(params.binary_file);
 
-   atomic<size_t> next_to_do = 0;
-   vector<thread*> threads;
+   unique_ptr<trace_writer_t> trace;
+   if (params.trace_file.size() > 0)
+      trace = make_unique<trace_writer_t>(params.trace_file);
 
-   // Search number sets.
-   for (size_t i = 0; i < thread::hardware_concurrency() - 1; ++i)
-   //for (size_t i = 0; i < 1; ++i)
+   if (params.scaling_study)
    {
-      threads.push_back(new thread([&combiners, &next_to_do]()
-         {
-            while (true)
-            {
-               const size_t which = next_to_do.fetch_add(1);
-               if (which >= combiners.size())
-                  break;
-               combiner_t& combiner = combiners[which];
-               combiner.combine();
-            }
-         }));
+      run_scaling(params, common_config);
+      return 0;
    }
 
-   // Show progression of search.
-   threads.push_back(new thread([&combiners, &next_to_do]()
-      {
-         size_t current_percent = 0;
-         const size_t thread_count = thread::hardware_concurrency();
-         size_t best_pair_count = 0;
-         size_t max_improvement_count = 0;
-         duration_t duration;
-
-         auto print_progress = [&combiners, &next_to_do, &thread_count, &duration, &best_pair_count, &max_improvement_count](size_t percent)
-         {
-            size_t current_combiner_index = next_to_do.load();
-            for (size_t i = current_combiner_index - thread_count; i < current_combiner_index; ++i)
-            {
-               const size_t pair_count = combiners[i].improver.best_pair_count;
-               const size_t improvement_count = combiners[i].improver.improvement_count;
-               best_pair_count = std::max(best_pair_count, pair_count);
-               max_improvement_count = std::max(max_improvement_count, improvement_count);
-            }
-            std::cout << setw(3) << percent << "% " << setw(5) << duration.elapsed() << " " << best_pair_count << " pairs " << max_improvement_count << " improvements\r";
-         };
-
-         while (true)
-         {
-            size_t skip_count = 0;
-            this_thread::sleep_for(chrono::milliseconds(100));
-            const size_t which = next_to_do.load();
-            if (which >= combiners.size())
-            {
-               current_percent = 100;
-               break;
-            }
-            const size_t percent = 100 * which / combiners.size();
-            if (percent == current_percent)
-            {
-               skip_count += 1;
-               if (skip_count < 20)
-                  continue;
-               skip_count = 0;
-            }
-            current_percent = percent;
-            print_progress(percent);
-            std::cout.flush();
-         }
-         print_progress(100);
-         cout << endl;
-      }));
-
-   // For for it all to end.
-   for (size_t i = 0; i < threads.size(); ++i)
+   if (params.baseline.size() > 0)
    {
-      threads[i]->join();
+      search_config_t config = common_config;
+      config.thread_pool = &thread_pool;
+      return run_regression(params, config);
    }
 
-   number_set_t best_number_set(combiners[0].number_set_size);
-   size_t best_pair_count = 0;
-   for (const combiner_t& combiner : combiners)
+   for (size_t number_set_size = params.min_set_size; number_set_size <= params.max_set_size; ++number_set_size)
    {
-      if (combiner.improver.best_pair_count > best_pair_count)
+      duration_t duration;
+
+      search_config_t config = common_config;
+      config.set_size = number_set_size;
+      config.thread_pool = &thread_pool;
+
+      search_callbacks_t callbacks;
+      size_t current_percent = size_t(-1);
+      callbacks.progress = [&current_percent](const search_progress_t& progress) { print_progress(progress, current_percent); };
+      if (trace)
+         callbacks.improvement = [&trace](const search_improvement_t& improvement) { trace->write(improvement); };
+
+      const search_result_t result = params.widen_step > 0 && !params.use_simplified_algo
+         ? widen_search_with_checkpoints(params, config, callbacks)
+         : search(config, callbacks);
+
+      if (!params.use_simplified_algo)
       {
-         best_number_set = combiner.improver.best_number_set;
-         best_pair_count = combiner.improver.best_pair_count;
+         std::cout << endl;
+         std::cout << result.triplet_count << " triplets, using " << result.combiner_count << " combiners." << endl;
+         std::cout << "Tried " << result.combination_count << " combinations with " << result.best_number_set.improvement_count << " improvements." << endl;
       }
-   }
 
-   best_number_set.simplify();
-   return best_number_set;
-}
-number_set_t simple_algo(size_t number_set_size)
-{
-   number_set_t best_number_set(number_set_size);
-   for (my_int_t min_delta_for_negative = 0; min_delta_for_negative < 20; min_delta_for_negative += 2)
-   {
-      number_set_t number_set(number_set_size);
-      for (my_int_t delta = 1; !number_set.is_filled(); delta += 2)
+      print_result(duration, config, result, params.summary_only);
+      if (binary)
+         write_binary_result(*binary, config, result);
+
+      if (common_config.shared_best)
       {
-         number_set.add(delta);
-         if (delta > min_delta_for_negative)
-            number_set.add(-delta + 2);
+         const shared_best_t::snapshot_t host_best = common_config.shared_best->read(number_set_size);
+         std::cout << "Best on this host: " << host_best.pair_count << " pairs:";
+         for (const my_int_t number : host_best.numbers)
+            std::cout << " " << number;
+         std::cout << endl;
       }
-      if (number_set.count_pairs() > best_number_set.count_pairs())
-         best_number_set = number_set;
    }
-   return best_number_set;
-}
 
-void print_result(const duration_t& duration, const number_set_t& number_set)
-{
-   std::cout << number_set.desired_size << " numbers in " << duration.elapsed() << ":";
-   for (const my_int_t number : set<my_int_t>(number_set.numbers.begin(), number_set.numbers.end()))
-      std::cout << " " << number;
-   std::cout << endl;
-
-   const vector<power_pair_t> pairs = number_set.generate_pairs();
-   std::cout << pairs.size() << " powers pairs:";
-   for (const auto& pair : pairs)
-      std::cout << " " << pair.a << "+" << pair.b << "=" << pair.sum();
-   std::cout << endl;
+   return 0;
 }
 
-// Parameters of the program.
-struct parameters_t : command_line_data_t
+// Stop the profiler, write its folded stacks to the file and show the time of each phase.
+void write_profile(sampling_profiler_t& profiler, const string& file_name)
 {
-   bool use_simplified_algo = false;
-   size_t min_set_size = 5;
-   size_t max_set_size = 5;
-   size_t triplet_count = 20;
-   size_t combiner_levels = 5;
-   my_int_t max_power_of_two = 9;
-
-   parameters_t()
-   {
-      validate();
-   }
+   profiler.stop();
 
-   void validate() override
-   {
-      min_set_size = std::max(min_set_size, size_t(3));
-      max_set_size = std::max(max_set_size, min_set_size);
-      triplet_count = std::max(triplet_count, min_set_size / 2);
-      triplet_count = std::max(triplet_count, size_t(5));
-      combiner_levels = std::max(combiner_levels, size_t(2));
-      max_power_of_two = std::max(max_power_of_two, my_int_t(5));
-   }
-};
+   ofstream file(file_name);
+   if (!file)
+      throw runtime_error("Cannot write the profile file " + file_name + ".");
+   profiler.write_folded_stacks(file);
 
-// Concrete list of parameters.
-const vector<command_line_arg_t> command_line_args =
-{
-   { "use simpler algorithm",   "s", "simplified", nullptr, nullptr, make_arg(&parameters_t::use_simplified_algo) },
-   { "number of triplets",      "t", "triplets",   make_arg(&parameters_t::triplet_count), nullptr, nullptr		   },
-   { "combiner levels",         "c", "levels",     make_arg(&parameters_t::combiner_levels), nullptr, nullptr	   },
-   { "minimum number-set size", "m", "min",        make_arg(&parameters_t::min_set_size), nullptr, nullptr		   },
-   { "maximum number-set size", "x", "max",        make_arg(&parameters_t::max_set_size), nullptr, nullptr		   },
-   { "number of powers of two", "p", "powers",     nullptr, make_arg(&parameters_t::max_power_of_two), nullptr	   },
-};
+   std::cout << "Profile of the search phases:" << endl;
+   profiler.write_phase_table(std::cout);
+}
 
 // Actual algorithm to find good number sets.
 int main(int argc, const char** argv)
@@ -679,44 +403,25 @@ int main(int argc, const char** argv)
    {
       parameters_t params;
       parse_command_line(params, command_line_args, argc, argv);
-      powers_of_two = gen_powers_of_two(params.max_power_of_two);
-
-      for (size_t number_set_size = params.min_set_size; number_set_size <= params.max_set_size; ++number_set_size)
-      {
-         duration_t duration;
-
-         if (params.use_simplified_algo)
-         {
-            number_set_t number_set = simple_algo(number_set_size);
-            improver_t improver(number_set_size);
-            improver.improve(number_set);
-            print_result(duration, improver.best_number_set);
-         }
-         else
-         {
-            // Generate triplets of numbers all pair-wise summing to powers of two.
-            vector<power_triplet_t> triplets = generate_power_triplets(params.triplet_count);
-
-            // Generate all combinations of 10 triplets and keep the
-            // combination that has the most pair-wise sums of powers
-            // of two.
 
-            vector<combiner_t> combiners = generate_combiners(triplets, number_set_size, params.combiner_levels);
-            std::cout << "Using " << combiners.size() << " combiners." << endl;
+      search_config_t common_config = make_search_config(params);
 
-            const number_set_t number_set = run_combiners_in_threads(combiners);
+      unique_ptr<shared_best_t> shared_best;
+      if (params.shared_memory.size() > 0)
+      {
+         shared_best = make_unique<shared_best_t>(params.shared_memory);
+         common_config.shared_best = shared_best.get();
+      }
 
-            size_t total_combination_count = 0;
-            for (const auto& combiner : combiners)
-               total_combination_count += combiner.combination_count;
+      unique_ptr<sampling_profiler_t> profiler;
+      if (params.profile_file.size() > 0)
+         profiler = make_unique<sampling_profiler_t>();
 
-            std::cout << "Tried " << total_combination_count << " combinations with " << number_set.improvement_count << " improvements." << endl;
+      const int status = run_searches(params, common_config);
 
-            print_result(duration, number_set);
-         }
-      }
-
-      return 0;
+      if (profiler)
+         write_profile(*profiler, params.profile_file);
+      return status;
    }
    catch (const exception& ex)
    {
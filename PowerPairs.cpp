@@ -0,0 +1,178 @@
+#include "PowerPairs.h"
+
+#include <set>
+
+using namespace std;
+
+// Generate the powers of two from 2^0 up to 2^max_power.
+powers_t gen_powers_of_two(const my_int_t max_power)
+{
+   powers_t p2;
+   for (my_int_t pow = 0; pow <= max_power; ++pow)
+      p2.push_back(my_int_t(1) << pow);
+   return p2;
+}
+
+vector<my_int_t> power_of_two_targets_t::all_up_to(my_int_t limit)
+{
+   vector<my_int_t> powers;
+   for (size_t power = 0; power < max_reachable() && (my_int_t(1) << power) <= limit; ++power)
+      powers.push_back(my_int_t(1) << power);
+   return powers;
+}
+
+// Generate the powers of three up to 2^max_power.
+vector<my_int_t> gen_powers_of_three(const my_int_t max_power)
+{
+   const my_int_t limit = my_int_t(1) << max_power;
+   vector<my_int_t> p3;
+   for (my_int_t pow = 1; pow <= limit; pow *= 3)
+      p3.push_back(pow);
+   return p3;
+}
+
+// Generate the non-zero perfect squares up to 2^max_power.
+vector<my_int_t> gen_squares(const my_int_t max_power)
+{
+   const my_int_t limit = my_int_t(1) << max_power;
+   vector<my_int_t> squares;
+   for (my_int_t root = 1; root * root <= limit; ++root)
+      squares.push_back(root * root);
+   return squares;
+}
+
+listed_targets_t::listed_targets_t(vector<my_int_t> targets)
+   : values(move(targets))
+{
+   sort(values.begin(), values.end());
+   values.erase(unique(values.begin(), values.end()), values.end());
+
+   // Beyond this span, the bitmap would not fit in the caches anyway.
+   constexpr uint64_t max_bitmap_span = uint64_t(1) << 24;
+
+   if (values.size() <= 0 || uint64_t(values.back() - values.front()) >= max_bitmap_span)
+      return;
+
+   min_value = values.front();
+   span = uint64_t(values.back() - values.front()) + 1;
+   bits.resize((span + 63) / 64);
+   for (const my_int_t value : values)
+   {
+      const uint64_t index = uint64_t(value - min_value);
+      bits[index / 64] |= uint64_t(1) << (index % 64);
+   }
+}
+
+vector<my_int_t> listed_targets_t::all_up_to(my_int_t limit) const
+{
+   const auto first = lower_bound(values.begin(), values.end(), -limit);
+   const auto last = upper_bound(values.begin(), values.end(), limit);
+   return vector<my_int_t>(first, last);
+}
+
+// Generate triplets of numbers that all pair-wise form pairs according to the rule.
+template <class RULE>
+vector<power_triplet_t> generate_power_triplets(const RULE& rule, const size_t triplet_count, const my_int_t max_magnitude)
+{
+   set<power_triplet_t> triplet_set;
+
+   auto is_allowed = [max_magnitude](my_int_t number) { return max_magnitude <= 0 || (number >= -max_magnitude && number <= max_magnitude); };
+
+   my_int_t largest_target = 0;
+   for (const my_int_t target : rule.targets.values)
+      largest_target = std::max(largest_target, target < 0 ? -target : target);
+
+   my_int_t delta = 0;
+   while (triplet_set.size() < triplet_count)
+   {
+      // Past the magnitude limit, no new triplet can be found.
+      if (max_magnitude > 0 && delta >= max_magnitude)
+         break;
+
+      // When only the listed targets are reached, past twice the largest
+      // one sums find no new triplet and differences only find translations
+      // of the triplets already found. Powers of two reach unlisted powers:
+      // their triplets keep appearing at any distance.
+      if (RULE::reaches_only_listed && delta > 2 * largest_target && (!RULE::is_translation_invariant || triplet_set.size() <= 0))
+         break;
+
+      delta += 1;
+      for (my_int_t target : rule.targets.values)
+      {
+         my_int_t deltas[] = { delta, -delta };
+         for (my_int_t delta : deltas)
+         {
+            const my_int_t i = delta;
+            for (const my_int_t j : rule.complements(i, target))
+            {
+               if (i == j || !is_allowed(j))
+                  continue;
+
+               for (my_int_t k = -delta; k <= delta; ++k)
+               {
+                  if (k == 0 || k == i || k == j)
+                     continue;
+
+                  if (rule.is_pair(i, k) && rule.is_pair(j, k))
+                  {
+                     triplet_set.emplace(i, j, k);
+                  }
+               }
+            }
+         }
+      }
+   }
+
+   vector<power_triplet_t> triplets;
+   for (const auto& tri : triplet_set)
+      triplets.push_back(tri);
+
+   rotate(triplets.begin(), triplets.begin() + triplets.size() * 3 / 5, triplets.end());
+
+   return triplets;
+}
+
+template vector<power_triplet_t> generate_power_triplets(const power_of_two_rule_t&, const size_t, const my_int_t);
+template vector<power_triplet_t> generate_power_triplets(const power_of_two_difference_rule_t&, const size_t, const my_int_t);
+template vector<power_triplet_t> generate_power_triplets(const listed_sum_rule_t&, const size_t, const my_int_t);
+template vector<power_triplet_t> generate_power_triplets(const listed_difference_rule_t&, const size_t, const my_int_t);
+
+void number_set_t::simplify()
+{
+   if (numbers.size() <= 0)
+      return;
+
+   while (std::all_of(numbers.begin(), numbers.end(), [](my_int_t number) { return (number % 2) == 0; }))
+   {
+      unordered_set<my_int_t> new_numbers;
+      for (const my_int_t number : numbers)
+         new_numbers.insert(number / my_int_t(2));
+      new_numbers.swap(numbers);
+   }
+}
+
+vector<my_int_t> canonical_numbers(const number_set_t& number_set, bool simplify)
+{
+   vector<my_int_t> numbers(number_set.numbers.begin(), number_set.numbers.end());
+   sort(numbers.begin(), numbers.end());
+
+   if (!simplify || numbers.size() <= 0 || (numbers.front() == 0 && numbers.back() == 0))
+      return numbers;
+
+   while (std::all_of(numbers.begin(), numbers.end(), [](my_int_t number) { return (number % 2) == 0; }))
+      for (my_int_t& number : numbers)
+         number /= my_int_t(2);
+
+   return numbers;
+}
+
+bool is_canonically_better(const number_set_t& number_set, size_t pair_count, const number_set_t& other_set, size_t other_pair_count, bool simplify)
+{
+   if (pair_count != other_pair_count)
+      return pair_count > other_pair_count;
+
+   if (other_set.numbers.size() <= 0)
+      return number_set.numbers.size() > 0;
+
+   return canonical_numbers(number_set, simplify) < canonical_numbers(other_set, simplify);
+}
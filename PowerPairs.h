@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+// Allow changing integer types in case we ever get to use large powers of two.
+using my_int_t = int64_t;
+
+// Pair of numbers summing to a power of two.
+// Can be compared and thus used in sets, etc.
+struct power_pair_t
+{
+   my_int_t a, b;
+
+   power_pair_t(my_int_t i, my_int_t j)
+   {
+      a = std::min({ i, j });
+      b = std::max({ i, j });
+   }
+
+   my_int_t sum() const { return a + b; }
+   my_int_t difference() const { return b - a; }
+
+   auto operator<=>(const power_pair_t&) const = default;
+};
+
+// Triplets of numbers that all mutually pair-wise sum to powers of two.
+// Can be compared and thus used in sets, etc.
+// Can be checked for overlap with another triplet.
+struct power_triplet_t
+{
+   my_int_t a, b, c;
+
+   power_triplet_t(my_int_t i, my_int_t j, my_int_t k)
+   {
+      a = std::min({ i, j, k });
+      c = std::max({ i, j, k });
+      b = i + j + k - a - c;
+   }
+
+   bool overlaps(const power_triplet_t& other) const
+   {
+      if (*this == other)
+         return false;
+
+      return
+         (a == other.a) ||
+         (a == other.b) ||
+         (a == other.c) ||
+         (b == other.a) ||
+         (b == other.b) ||
+         (b == other.c) ||
+         (c == other.a) ||
+         (c == other.b) ||
+         (c == other.c);
+   }
+
+   my_int_t count_overlaps(const power_triplet_t& other) const
+   {
+      my_int_t count =
+         my_int_t(a == other.a) +
+         my_int_t(a == other.b) +
+         my_int_t(a == other.c) +
+         my_int_t(b == other.a) +
+         my_int_t(b == other.b) +
+         my_int_t(b == other.c) +
+         my_int_t(c == other.a) +
+         my_int_t(c == other.b) +
+         my_int_t(c == other.c);
+
+      return count == 3 ? 0 : count;
+   }
+
+   auto operator<=>(const power_triplet_t&) const = default;
+};
+
+// List of powers of two, in increasing order, used to generate
+// the complements of a number.
+using powers_t = std::vector<my_int_t>;
+
+// Generate the powers of two from 2^0 up to 2^max_power.
+powers_t gen_powers_of_two(const my_int_t max_power);
+
+inline bool is_power_of_two(my_int_t number) { return number != 0 && (number & (number - 1)) == 0; }
+
+// Targets that pairs of numbers must reach: any power of two,
+// tested with bit tricks. The listed values are those used to
+// generate complements.
+struct power_of_two_targets_t
+{
+   powers_t values;
+
+   static bool contains(my_int_t number) { return is_power_of_two(number); }
+
+   // Halving numbers that reach a target, all even, reaches a target.
+   static constexpr bool is_scalable = true;
+
+   // Unlisted powers of two are reached too, so triplets keep appearing at any distance.
+   static constexpr bool is_only_listed = false;
+
+   // Any power of two can be reached, not only the listed ones.
+   static size_t max_reachable() { return sizeof(my_int_t) * 8 - 1; }
+
+   // All the targets within [-limit, limit], listed or not.
+   static std::vector<my_int_t> all_up_to(my_int_t limit);
+};
+
+// Targets that pairs of numbers must reach: an arbitrary list
+// of values, tested with a dense bitmap when their span is small.
+struct listed_targets_t
+{
+   std::vector<my_int_t> values;
+
+   listed_targets_t() = default;
+   listed_targets_t(std::vector<my_int_t> targets);
+
+   bool contains(my_int_t number) const
+   {
+      const uint64_t index = uint64_t(number - min_value);
+      if (bits.size() > 0)
+         return index < span && ((bits[index / 64] >> (index % 64)) & 1u);
+      return std::binary_search(values.begin(), values.end(), number);
+   }
+
+   static constexpr bool is_scalable = false;
+
+   static constexpr bool is_only_listed = true;
+
+   size_t max_reachable() const { return values.size(); }
+
+   // All the targets within [-limit, limit].
+   std::vector<my_int_t> all_up_to(my_int_t limit) const;
+
+private:
+   my_int_t min_value = 0;
+   uint64_t span = 0;
+   std::vector<uint64_t> bits;
+};
+
+// Generate the powers of three up to 2^max_power.
+std::vector<my_int_t> gen_powers_of_three(const my_int_t max_power);
+
+// Generate the non-zero perfect squares up to 2^max_power.
+std::vector<my_int_t> gen_squares(const my_int_t max_power);
+
+// Pairs of numbers whose sum reaches a target.
+struct sum_operation_t
+{
+   static my_int_t combine(my_int_t a, my_int_t b) { return a + b; }
+
+   // Numbers that reach the target when combined with the given number.
+   static std::array<my_int_t, 1> complements(my_int_t number, my_int_t target) { return { target - number }; }
+
+   static constexpr bool is_translation_invariant = false;
+};
+
+// Pairs of numbers whose difference reaches a target.
+struct difference_operation_t
+{
+   static my_int_t combine(my_int_t a, my_int_t b) { return a > b ? a - b : b - a; }
+
+   static std::array<my_int_t, 2> complements(my_int_t number, my_int_t target) { return { number + target, number - target }; }
+
+   // Adding the same number to both members keeps the difference.
+   static constexpr bool is_translation_invariant = true;
+};
+
+// What makes two numbers a pair: how they are combined and which
+// targets the combination must reach. Selected once at startup so
+// that the search is compiled for each rule, keeping the bit tricks
+// of the powers of two in the inner loops.
+template <class TARGETS, class OPERATION>
+struct pair_rule_t
+{
+   TARGETS targets;
+
+   bool is_pair(my_int_t a, my_int_t b) const { return targets.contains(OPERATION::combine(a, b)); }
+
+   static auto complements(my_int_t number, my_int_t target) { return OPERATION::complements(number, target); }
+
+   // Every target that pairs of numbers within [-bound, bound] can reach,
+   // including those not listed, so that the complements for these targets
+   // are all the partners of a number.
+   std::vector<my_int_t> partner_targets(my_int_t bound) const
+   {
+      const my_int_t limit = bound < std::numeric_limits<my_int_t>::max() / 2 ? 2 * bound : std::numeric_limits<my_int_t>::max();
+      std::vector<my_int_t> partners = targets.all_up_to(limit);
+
+      // Drop the targets the operation cannot give, like negative differences.
+      std::erase_if(partners, [](my_int_t target) { return OPERATION::combine(0, OPERATION::complements(0, target)[0]) != target; });
+      return partners;
+   }
+
+   // Whether dividing all numbers by two when they are all even keeps the pairs.
+   static constexpr bool can_simplify = TARGETS::is_scalable;
+
+   static constexpr bool is_translation_invariant = OPERATION::is_translation_invariant;
+
+   // Whether only the listed targets are reached, not any value the targets contain.
+   static constexpr bool reaches_only_listed = TARGETS::is_only_listed;
+};
+
+using power_of_two_rule_t = pair_rule_t<power_of_two_targets_t, sum_operation_t>;
+using power_of_two_difference_rule_t = pair_rule_t<power_of_two_targets_t, difference_operation_t>;
+using listed_sum_rule_t = pair_rule_t<listed_targets_t, sum_operation_t>;
+using listed_difference_rule_t = pair_rule_t<listed_targets_t, difference_operation_t>;
+
+// Generate triplets of numbers that all pair-wise form pairs according to the rule.
+// A non-zero max_magnitude only keeps triplets within [-max_magnitude, max_magnitude],
+// in which case fewer triplets than requested may be returned.
+template <class RULE>
+std::vector<power_triplet_t> generate_power_triplets(const RULE& rule, const size_t triplet_count, const my_int_t max_magnitude = 0);
+
+// Largest magnitude supported by the bounded mode.
+constexpr my_int_t max_supported_magnitude = my_int_t(1) << 30;
+
+// A set of N numbers (N equal to desired_size) that have many
+// pair-wise sums equal to powers of two.
+//
+// Can be progressively filled with triplets until the desired
+// size is reached.
+//
+// Can generates the full list of pair-wise sums of powers of two
+// that are produced by the set of numbers.
+struct number_set_t
+{
+   size_t desired_size;
+   size_t improvement_count = 0;
+   std::unordered_set<my_int_t> numbers;
+
+   number_set_t(size_t size) : desired_size(size) {}
+
+   void reset() { improvement_count = 0; numbers.clear(); }
+
+   bool is_filled() const { return desired_size == numbers.size(); }
+
+   void add(const my_int_t number)
+   {
+      if (!is_filled())
+         numbers.insert(number);
+   }
+   void add(const power_triplet_t& tri)
+   {
+      add(tri.a);
+      add(tri.b);
+      add(tri.c);
+   }
+
+   void simplify();
+
+   template <class RULE = power_of_two_rule_t>
+   size_t count_pairs(const RULE& rule = RULE()) const
+   {
+      size_t count = 0;
+      const auto numbers_end = numbers.end();
+      for (auto i1 = numbers.begin(); i1 != numbers_end; ++i1)
+      {
+         for (auto i2 = std::next(i1); i2 != numbers_end; ++i2)
+         {
+            const my_int_t n1 = *i1;
+            const my_int_t n2 = *i2;
+            if (!rule.is_pair(n1, n2))
+               continue;
+
+            count += 1;
+         }
+      }
+      return count;
+   }
+
+   template <class RULE = power_of_two_rule_t>
+   std::vector<power_pair_t> generate_pairs(const RULE& rule = RULE()) const
+   {
+      std::vector<power_pair_t> pairs;
+      pairs.reserve(desired_size * 3);
+      const auto numbers_end = numbers.end();
+      for (auto i1 = numbers.begin(); i1 != numbers_end; ++i1)
+      {
+         for (auto i2 = std::next(i1); i2 != numbers_end; ++i2)
+         {
+            const my_int_t n1 = *i1;
+            const my_int_t n2 = *i2;
+            if (!rule.is_pair(n1, n2))
+               continue;
+
+            pairs.emplace_back(n1, n2);
+         }
+      }
+      return pairs;
+   }
+};
+
+// Numbers of the set once simplified, in increasing order.
+// Two number sets that only differ by a power of two scaling
+// have the same canonical numbers, unless simplify is false.
+std::vector<my_int_t> canonical_numbers(const number_set_t& number_set, bool simplify = true);
+
+// Verify if a number set is better than another: more pairs or, for
+// the same number of pairs, lexicographically smaller canonical numbers.
+// This gives a total order that does not depend on how the sets were found.
+bool is_canonically_better(const number_set_t& number_set, size_t pair_count, const number_set_t& other_set, size_t other_pair_count, bool simplify = true);
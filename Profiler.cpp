@@ -0,0 +1,341 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+   // Frames kept per sample, the interrupted function included.
+   constexpr size_t max_frames = 16;
+
+   // Samples whose stack is kept; later samples only count in their phase.
+   constexpr size_t max_samples = size_t(1) << 17;
+
+   struct sample_t
+   {
+      search_phase_t phase;
+      uint8_t frame_count;
+      uintptr_t frames[max_frames];
+   };
+}
+
+const char* phase_name(search_phase_t phase)
+{
+   switch (phase)
+   {
+      case search_phase_t::triplet_generation:   return "triplet generation";
+      case search_phase_t::combiner_enumeration: return "combiner enumeration";
+      case search_phase_t::pair_counting:        return "pair counting";
+      case search_phase_t::improver:             return "improver";
+      case search_phase_t::reduction:            return "reduction";
+      default:                                   return "other";
+   }
+}
+
+struct sampling_profiler_t::state_t
+{
+   atomic<uint64_t> phase_counts[search_phase_count] = {};
+   atomic<size_t> next_sample = 0;
+
+   // Left uninitialized so that only the pages used take memory.
+   // Only read once stopped, when no handler writes them anymore.
+   unique_ptr<sample_t[]> samples{ new sample_t[max_samples] };
+
+#if defined(__linux__)
+   timer_t timer{};
+#endif
+   bool running = false;
+};
+
+atomic<sampling_profiler_t::state_t*> sampling_profiler_t::running_state = nullptr;
+atomic<size_t> sampling_profiler_t::running_handlers = 0;
+
+#if defined(__linux__)
+
+void note_profiled_stack()
+{
+   // Without its bounds, no frame of the stack is followed.
+   profiled_stack_low = 0;
+   profiled_stack_high = 1;
+
+   pthread_attr_t attributes;
+   if (pthread_getattr_np(pthread_self(), &attributes) != 0)
+      return;
+
+   void* low = nullptr;
+   size_t size = 0;
+   if (pthread_attr_getstack(&attributes, &low, &size) == 0)
+   {
+      profiled_stack_low = uintptr_t(low);
+      profiled_stack_high = uintptr_t(low) + size;
+   }
+   pthread_attr_destroy(&attributes);
+}
+
+namespace
+{
+   // Follow the frame pointers from the interrupted context, only reading
+   // within the stack of the thread. Async-signal-safe.
+   size_t capture_frames(void* context, uintptr_t* frames)
+   {
+      const ucontext_t* user_context = static_cast<const ucontext_t*>(context);
+#if defined(__x86_64__)
+      const uintptr_t pc = uintptr_t(user_context->uc_mcontext.gregs[REG_RIP]);
+      uintptr_t frame = uintptr_t(user_context->uc_mcontext.gregs[REG_RBP]);
+#elif defined(__aarch64__)
+      const uintptr_t pc = uintptr_t(user_context->uc_mcontext.pc);
+      uintptr_t frame = uintptr_t(user_context->uc_mcontext.regs[29]);
+#else
+      const uintptr_t pc = 0;
+      uintptr_t frame = 0;
+      (void)user_context;
+#endif
+      if (pc == 0)
+         return 0;
+
+      size_t count = 0;
+      frames[count++] = pc;
+
+      const uintptr_t low = profiled_stack_low;
+      const uintptr_t high = profiled_stack_high;
+      while (count < max_frames && frame >= low && high - low >= 2 * sizeof(uintptr_t) && frame <= high - 2 * sizeof(uintptr_t) && frame % sizeof(uintptr_t) == 0)
+      {
+         const uintptr_t* links = reinterpret_cast<const uintptr_t*>(frame);
+         const uintptr_t caller_frame = links[0];
+         const uintptr_t return_address = links[1];
+         if (return_address == 0)
+            break;
+         frames[count++] = return_address;
+
+         // Frames go up the stack: anything else is not a frame pointer.
+         if (caller_frame <= frame)
+            break;
+         frame = caller_frame;
+      }
+      return count;
+   }
+
+   string frame_name(uintptr_t address)
+   {
+      Dl_info info{};
+      if (dladdr(reinterpret_cast<void*>(address), &info) == 0)
+         return "[unknown]";
+
+      if (info.dli_sname)
+      {
+         int status = 0;
+         char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+         string name = status == 0 && demangled ? demangled : info.dli_sname;
+         free(demangled);
+         return name;
+      }
+
+      // Without exported symbols, like in executables not linked with
+      // -rdynamic, give the offset in the module for addr2line.
+      string module = info.dli_fname ? info.dli_fname : "[unknown]";
+      module = module.substr(module.find_last_of('/') + 1);
+      ostringstream name;
+      name << module << "+0x" << hex << (address - uintptr_t(info.dli_fbase));
+      return name.str();
+   }
+}
+
+sampling_profiler_t::sampling_profiler_t(size_t frequency)
+   : state(make_unique<state_t>())
+{
+   state_t* expected = nullptr;
+   if (!running_state.compare_exchange_strong(expected, state.get()))
+      throw runtime_error("Only one profiler can run at a time.");
+
+   struct sigaction action{};
+   action.sa_flags = SA_SIGINFO | SA_RESTART;
+   sigemptyset(&action.sa_mask);
+   action.sa_sigaction = [](int, siginfo_t*, void* context)
+   {
+      const int saved_errno = errno;
+      running_handlers.fetch_add(1);
+      state_t* running = running_state.load();
+      if (running)
+      {
+         const search_phase_t phase = current_search_phase;
+         running->phase_counts[size_t(phase) < search_phase_count ? size_t(phase) : 0].fetch_add(1, memory_order_relaxed);
+
+         const size_t index = running->next_sample.fetch_add(1, memory_order_relaxed);
+         if (index < max_samples)
+         {
+            sample_t& sample = running->samples[index];
+            sample.phase = phase;
+            sample.frame_count = uint8_t(capture_frames(context, sample.frames));
+         }
+      }
+      running_handlers.fetch_sub(1);
+      errno = saved_errno;
+   };
+
+   if (sigaction(SIGPROF, &action, nullptr) != 0)
+   {
+      running_state = nullptr;
+      throw runtime_error("Cannot handle the profiling signal.");
+   }
+
+   sigevent event{};
+   event.sigev_notify = SIGEV_SIGNAL;
+   event.sigev_signo = SIGPROF;
+   if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &event, &state->timer) != 0)
+   {
+      running_state = nullptr;
+      throw runtime_error("Cannot create the profiling timer.");
+   }
+
+   const long period = 1000000000L / long(std::clamp(frequency, size_t(1), size_t(100000)));
+   itimerspec interval{};
+   interval.it_interval.tv_sec = period / 1000000000L;
+   interval.it_interval.tv_nsec = period % 1000000000L;
+   interval.it_value = interval.it_interval;
+   timer_settime(state->timer, 0, &interval, nullptr);
+   state->running = true;
+   is_profiling = true;
+
+   // The calling thread usually enters no phase before the search starts.
+   if (profiled_stack_high == 0)
+      note_profiled_stack();
+}
+
+void sampling_profiler_t::stop()
+{
+   if (!state->running)
+      return;
+   state->running = false;
+   is_profiling = false;
+
+   timer_delete(state->timer);
+   running_state = nullptr;
+
+   // Signals already sent find no running state. Wait for the handlers
+   // that were already using it. The handler stays installed, since by
+   // default a signal still pending would terminate the process.
+   while (running_handlers.load() > 0)
+      this_thread::yield();
+}
+
+#else
+
+void note_profiled_stack()
+{
+   // Only Linux stacks are followed; this avoids noting the stack again.
+   profiled_stack_high = 1;
+}
+
+sampling_profiler_t::sampling_profiler_t(size_t)
+{
+   throw runtime_error("The sampling profiler is only supported on Linux.");
+}
+
+void sampling_profiler_t::stop()
+{
+}
+
+#endif
+
+sampling_profiler_t::~sampling_profiler_t()
+{
+   if (state)
+      stop();
+}
+
+array<uint64_t, search_phase_count> sampling_profiler_t::phase_samples() const
+{
+   array<uint64_t, search_phase_count> counts{};
+   for (size_t phase = 0; phase < search_phase_count; ++phase)
+      counts[phase] = state->phase_counts[phase].load();
+   return counts;
+}
+
+uint64_t sampling_profiler_t::dropped_samples() const
+{
+   const size_t taken = state->next_sample.load();
+   return taken > max_samples ? taken - max_samples : 0;
+}
+
+void sampling_profiler_t::write_folded_stacks(ostream& out) const
+{
+   if (state->running)
+      throw logic_error("Stop the profiler before reading its stacks.");
+
+#if defined(__linux__)
+   map<uintptr_t, string> names;
+   auto name_of = [&names](uintptr_t address)
+   {
+      auto where = names.find(address);
+      if (where == names.end())
+      {
+         string name = frame_name(address);
+         replace(name.begin(), name.end(), ';', ':');
+         where = names.emplace(address, move(name)).first;
+      }
+      return where->second;
+   };
+
+   map<string, uint64_t> stacks;
+   const size_t count = std::min(state->next_sample.load(), max_samples);
+   for (size_t index = 0; index < count; ++index)
+   {
+      const sample_t& sample = state->samples[index];
+      string stack = phase_name(sample.phase);
+      for (size_t frame = sample.frame_count; frame > 0; --frame)
+      {
+         // Return addresses point after the call: look up the call itself.
+         const uintptr_t address = sample.frames[frame - 1];
+         stack += ';';
+         stack += name_of(frame - 1 > 0 ? address - 1 : address);
+      }
+      stacks[stack] += 1;
+   }
+
+   for (const auto& [stack, samples] : stacks)
+      out << stack << " " << samples << "\n";
+#else
+   (void)out;
+#endif
+}
+
+void sampling_profiler_t::write_phase_table(ostream& out) const
+{
+   const array<uint64_t, search_phase_count> counts = phase_samples();
+   uint64_t total = 0;
+   for (const uint64_t count : counts)
+      total += count;
+
+   out << "phase                  samples  percent" << endl;
+   for (size_t phase = 0; phase < search_phase_count; ++phase)
+   {
+      out << left << setw(20) << phase_name(search_phase_t(phase)) << right
+          << setw(10) << counts[phase]
+          << fixed << setprecision(1) << setw(8) << (total > 0 ? 100. * double(counts[phase]) / double(total) : 0.) << "%"
+          << defaultfloat << endl;
+   }
+   out << left << setw(20) << "total" << right << setw(10) << total << endl;
+
+   if (dropped_samples() > 0)
+      out << dropped_samples() << " samples were only counted, their stacks did not fit." << endl;
+}
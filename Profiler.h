@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+
+// Phases of a search, to which the samples of the profiler are attributed.
+enum class search_phase_t : uint8_t
+{
+   other,
+   triplet_generation,
+   combiner_enumeration,
+   pair_counting,
+   improver,
+   reduction,
+};
+
+constexpr size_t search_phase_count = 6;
+
+const char* phase_name(search_phase_t phase);
+
+// Whether a profiler runs, so that phase scopes cost a single test otherwise.
+inline constinit std::atomic<bool> is_profiling = false;
+
+// Phase of the calling thread, read by the profiler when it interrupts the thread.
+inline constinit thread_local search_phase_t current_search_phase = search_phase_t::other;
+
+// Stack of the calling thread, within which the profiler follows frame pointers.
+// Both zero until the thread first enters a phase.
+inline constinit thread_local uintptr_t profiled_stack_low = 0;
+inline constinit thread_local uintptr_t profiled_stack_high = 0;
+
+void note_profiled_stack();
+
+// Tag the work of the calling thread with a phase until the end of the scope.
+// Scopes entered while no profiler runs do nothing.
+struct phase_scope_t
+{
+   phase_scope_t(search_phase_t phase) : is_tagging(is_profiling.load(std::memory_order_relaxed))
+   {
+      if (!is_tagging)
+         return;
+      if (profiled_stack_high == 0)
+         note_profiled_stack();
+      previous = current_search_phase;
+      current_search_phase = phase;
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+   }
+
+   ~phase_scope_t()
+   {
+      if (!is_tagging)
+         return;
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+      current_search_phase = previous;
+   }
+
+   phase_scope_t(const phase_scope_t&) = delete;
+   phase_scope_t& operator=(const phase_scope_t&) = delete;
+
+private:
+   const bool is_tagging;
+   search_phase_t previous = search_phase_t::other;
+};
+
+// Switch the phase of the calling thread without a scope, for loops too
+// hot for one. Only worth it while a profiler runs.
+inline void set_search_phase(search_phase_t phase)
+{
+   std::atomic_signal_fence(std::memory_order_seq_cst);
+   current_search_phase = phase;
+   std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+// In-process sampling profiler, for environments where no external
+// profiler can run.
+//
+// A timer interrupts the process with SIGPROF at a fixed rate of its CPU
+// time. The interrupted thread records its phase and its stack, followed
+// through frame pointers, in a lock-free buffer shared by all threads.
+// Stacks beyond the interrupted function need a build that keeps frame
+// pointers, like with -fno-omit-frame-pointer; the phases are always
+// counted. Phases entered before the profiler starts are not tagged.
+// Only one profiler can run at a time. Linux only.
+struct sampling_profiler_t
+{
+   // Samples per second of CPU time.
+   sampling_profiler_t(size_t frequency = 997);
+   ~sampling_profiler_t();
+
+   sampling_profiler_t(const sampling_profiler_t&) = delete;
+   sampling_profiler_t& operator=(const sampling_profiler_t&) = delete;
+
+   // Stop sampling. The samples taken remain available.
+   void stop();
+
+   // Samples taken in each phase, including those whose stack was dropped.
+   std::array<uint64_t, search_phase_count> phase_samples() const;
+
+   // Samples whose stack did not fit in the buffer.
+   uint64_t dropped_samples() const;
+
+   // Once stopped, write the stacks in the folded format of flame graphs: one line
+   // per distinct stack, its phase then its frames from the root,
+   // separated by semicolons, followed by its sample count.
+   void write_folded_stacks(std::ostream& out) const;
+
+   // Write a table of the percentage of samples of each phase.
+   void write_phase_table(std::ostream& out) const;
+
+private:
+   struct state_t;
+   std::unique_ptr<state_t> state;
+
+   // State of the running profiler, read by the signal handler.
+   static std::atomic<state_t*> running_state;
+   static std::atomic<size_t> running_handlers;
+};
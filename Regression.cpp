@@ -0,0 +1,169 @@
+#include "Regression.h"
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+
+namespace
+{
+   // Short runs are too noisy for a relative tolerance alone.
+   constexpr chrono::milliseconds min_slack{ 20 };
+
+   chrono::milliseconds elapsed_since(chrono::steady_clock::time_point start)
+   {
+      return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+   }
+
+   bool is_too_slow(chrono::milliseconds time, chrono::milliseconds baseline_time, double tolerance)
+   {
+      const auto allowed = std::max(chrono::milliseconds(chrono::milliseconds::rep(baseline_time.count() * (1. + tolerance))), baseline_time + min_slack);
+      return time > allowed;
+   }
+}
+
+const vector<regression_case_t>& known_optima()
+{
+   // Each takes at least about 100ms with a single thread.
+   static const vector<regression_case_t> cases =
+   {
+      {  3,  3, 60 },
+      {  4,  4, 30 },
+      {  5,  6, 30 },
+      {  6,  7, 30 },
+      {  7,  9, 30 },
+      {  8, 11, 30 },
+      {  9, 13, 30 },
+      { 10, 15, 30 },
+      { 11, 17, 30 },
+      { 12, 19, 30 },
+   };
+   return cases;
+}
+
+vector<regression_timing_t> run_regression_cases(const vector<regression_case_t>& cases, const search_config_t& config)
+{
+   unique_ptr<thread_pool_t> own_pool;
+   thread_pool_t* pool = config.thread_pool;
+   if (!pool)
+   {
+      own_pool = make_unique<simple_thread_pool_t>(config.thread_count);
+      pool = own_pool.get();
+   }
+
+   vector<regression_timing_t> timings;
+   for (const regression_case_t& regression_case : cases)
+   {
+      search_config_t case_config = config;
+      case_config.set_size = regression_case.set_size;
+      case_config.triplet_count = std::max(config.triplet_count, regression_case.triplet_count);
+      case_config.deterministic = true;
+      case_config.thread_pool = pool;
+
+      regression_timing_t timing;
+      timing.set_size = regression_case.set_size;
+      timing.thread_count = pool->thread_count();
+      timing.triplet_count = case_config.triplet_count;
+      timing.combiner_levels = case_config.combiner_levels;
+      timing.max_power_of_two = case_config.max_power_of_two;
+
+      // Improvements are reported as they are found, unlike progress,
+      // which only comes when a whole combiner completes.
+      const auto start = chrono::steady_clock::now();
+      bool reached = false;
+      search_callbacks_t callbacks;
+      callbacks.improvement = [&](const search_improvement_t& improvement)
+      {
+         if (!reached && improvement.pair_count >= regression_case.expected_pair_count)
+         {
+            reached = true;
+            timing.time_to_optimum = elapsed_since(start);
+         }
+      };
+
+      const search_result_t result = search(case_config, callbacks);
+      timing.total_time = elapsed_since(start);
+      timing.pair_count = result.pair_count;
+      if (!reached)
+         timing.time_to_optimum = timing.total_time;
+
+      timings.push_back(timing);
+   }
+   return timings;
+}
+
+bool is_same_search(const regression_timing_t& timing, const regression_timing_t& other)
+{
+   return timing.set_size == other.set_size
+       && timing.thread_count == other.thread_count
+       && timing.triplet_count == other.triplet_count
+       && timing.combiner_levels == other.combiner_levels
+       && timing.max_power_of_two == other.max_power_of_two;
+}
+
+vector<regression_timing_t> read_baseline(const string& file_name)
+{
+   ifstream file(file_name);
+   if (!file)
+      throw runtime_error("Cannot open the baseline file " + file_name + ".");
+
+   vector<regression_timing_t> baseline;
+   string line;
+   while (getline(file, line))
+   {
+      if (line.size() <= 0 || line[0] == '#')
+         continue;
+
+      istringstream istr(line);
+      regression_timing_t timing;
+      chrono::milliseconds::rep time_to_optimum = 0;
+      chrono::milliseconds::rep total_time = 0;
+      if (!(istr >> timing.set_size >> timing.thread_count >> timing.triplet_count >> timing.combiner_levels >> timing.max_power_of_two
+                 >> timing.pair_count >> time_to_optimum >> total_time))
+         throw runtime_error("Invalid line in the baseline file " + file_name + ": " + line);
+      timing.time_to_optimum = chrono::milliseconds(time_to_optimum);
+      timing.total_time = chrono::milliseconds(total_time);
+      baseline.push_back(timing);
+   }
+   return baseline;
+}
+
+void write_baseline(const string& file_name, const vector<regression_timing_t>& timings)
+{
+   ofstream file(file_name);
+   if (!file)
+      throw runtime_error("Cannot write the baseline file " + file_name + ".");
+
+   file << "# set-size threads triplets levels powers pairs time-to-optimum-ms total-ms" << endl;
+   for (const regression_timing_t& timing : timings)
+      file << timing.set_size << " " << timing.thread_count << " " << timing.triplet_count << " " << timing.combiner_levels << " " << timing.max_power_of_two << " "
+           << timing.pair_count << " " << timing.time_to_optimum.count() << " " << timing.total_time.count() << endl;
+}
+
+vector<string> compare_with_baseline(const vector<regression_case_t>& cases, const vector<regression_timing_t>& timings, const vector<regression_timing_t>& baseline, double tolerance)
+{
+   vector<string> failures;
+   for (size_t i = 0; i < cases.size() && i < timings.size(); ++i)
+   {
+      const regression_case_t& regression_case = cases[i];
+      const regression_timing_t& timing = timings[i];
+      const string name = "size " + to_string(timing.set_size) + " with " + to_string(timing.triplet_count) + " triplets and " + to_string(timing.thread_count) + " threads: ";
+
+      if (timing.pair_count != regression_case.expected_pair_count)
+         failures.push_back(name + "found " + to_string(timing.pair_count) + " pairs instead of " + to_string(regression_case.expected_pair_count) + ".");
+
+      // Only compare with baseline runs of the same configuration.
+      for (const regression_timing_t& base : baseline)
+      {
+         if (!is_same_search(base, timing))
+            continue;
+
+         if (is_too_slow(timing.time_to_optimum, base.time_to_optimum, tolerance))
+            failures.push_back(name + "reached the optimum in " + to_string(timing.time_to_optimum.count()) + "ms, the baseline in " + to_string(base.time_to_optimum.count()) + "ms.");
+         if (is_too_slow(timing.total_time, base.total_time, tolerance))
+            failures.push_back(name + "took " + to_string(timing.total_time.count()) + "ms, the baseline " + to_string(base.total_time.count()) + "ms.");
+      }
+   }
+   return failures;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Search.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// One search of the regression suite, with its known best pair count
+// and enough triplets for the search to take long enough to be timed.
+struct regression_case_t
+{
+   size_t set_size = 0;
+   size_t expected_pair_count = 0;
+   size_t triplet_count = 0;
+};
+
+// Measured outcome of one regression case, with the parameters of its search.
+struct regression_timing_t
+{
+   size_t set_size = 0;
+   size_t thread_count = 0;
+   size_t triplet_count = 0;
+   size_t combiner_levels = 0;
+   my_int_t max_power_of_two = 0;
+   size_t pair_count = 0;
+   std::chrono::milliseconds time_to_optimum{};
+   std::chrono::milliseconds total_time{};
+};
+
+// Set sizes whose best pair counts are known.
+const std::vector<regression_case_t>& known_optima();
+
+// Run the full search of each case with the given configuration, made
+// deterministic so that the results only depend on the code. Each case
+// uses its own triplet count unless the configuration has more.
+std::vector<regression_timing_t> run_regression_cases(const std::vector<regression_case_t>& cases, const search_config_t& config);
+
+// Whether two timings come from searches of the same parameters.
+bool is_same_search(const regression_timing_t& timing, const regression_timing_t& other);
+
+// The baseline file has one line per case: set size, thread count, triplet
+// count, combiner levels, max power of two, pair count, then the time to
+// reach the optimum and the total time, in milliseconds.
+std::vector<regression_timing_t> read_baseline(const std::string& file_name);
+void write_baseline(const std::string& file_name, const std::vector<regression_timing_t>& timings);
+
+// Compare the timings with the expected pair counts and with the baseline
+// lines of the same search parameters. Times may exceed the baseline by the
+// given fraction; shorter times are never a failure. Returns a description of each failure, empty when all pass.
+std::vector<std::string> compare_with_baseline(const std::vector<regression_case_t>& cases, const std::vector<regression_timing_t>& timings, const std::vector<regression_timing_t>& baseline, double tolerance);
@@ -0,0 +1,46 @@
+#include "Scaling.h"
+
+#include <thread>
+
+using namespace std;
+
+vector<size_t> scaling_thread_counts(size_t max_thread_count)
+{
+   if (max_thread_count <= 0)
+      max_thread_count = std::max(size_t(thread::hardware_concurrency()), size_t(1));
+
+   vector<size_t> counts;
+   for (size_t count = 1; count < max_thread_count; count *= 2)
+      counts.push_back(count);
+   counts.push_back(max_thread_count);
+   return counts;
+}
+
+vector<scaling_point_t> run_scaling_study(const search_config_t& config, size_t max_thread_count, size_t repetitions)
+{
+   vector<scaling_point_t> points;
+   for (const size_t thread_count : scaling_thread_counts(max_thread_count))
+   {
+      simple_thread_pool_t pool(thread_count, true);
+      search_config_t study_config = config;
+      study_config.thread_pool = &pool;
+
+      scaling_point_t point;
+      point.thread_count = thread_count;
+      for (size_t repetition = 0; repetition < std::max(repetitions, size_t(1)); ++repetition)
+      {
+         const auto start = chrono::steady_clock::now();
+         const search_result_t result = search(study_config);
+         const chrono::duration<double> wall_time = chrono::steady_clock::now() - start;
+
+         if (repetition == 0 || wall_time < point.wall_time)
+         {
+            point.wall_time = wall_time;
+            point.combination_count = result.combination_count;
+            point.expansion_count = result.expansion_count;
+         }
+      }
+      points.push_back(point);
+   }
+   return points;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// Measurement of the search with one thread count.
+struct scaling_point_t
+{
+   size_t thread_count = 0;
+
+   // Fastest of the repetitions.
+   std::chrono::duration<double> wall_time{};
+
+   size_t combination_count = 0;
+   size_t expansion_count = 0;
+
+   double combinations_per_second() const { return combination_count / std::max(wall_time.count(), 1e-9); }
+   double expansions_per_second() const { return expansion_count / std::max(wall_time.count(), 1e-9); }
+
+   // Relative to a measurement with fewer threads, usually one.
+   double speedup(const scaling_point_t& base) const { return base.wall_time.count() / std::max(wall_time.count(), 1e-9); }
+   double efficiency(const scaling_point_t& base) const { return speedup(base) * base.thread_count / thread_count; }
+};
+
+// Thread counts of the study: 1, 2, 4... up to the maximum, which is always included.
+std::vector<size_t> scaling_thread_counts(size_t max_thread_count);
+
+// Repeat the same search with each thread count, on pinned threads.
+std::vector<scaling_point_t> run_scaling_study(const search_config_t& config, size_t max_thread_count, size_t repetitions);
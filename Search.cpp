@@ -0,0 +1,442 @@
+#include "Search.h"
+#include "Combiner.h"
+#include "Profiler.h"
+#include "SeedLearning.h"
+#include "SharedBest.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+   // Call the function with the pair rule of the configured targets,
+   // so that everything it runs is compiled for that rule.
+   template <class FUNCTION>
+   auto with_rule(const search_config_t& config, FUNCTION&& function)
+   {
+      const my_int_t max_power = config.max_power_of_two;
+      switch (config.targets)
+      {
+         case target_kind_t::powers_of_two:
+         {
+            const power_of_two_targets_t targets{ gen_powers_of_two(max_power) };
+            if (config.use_differences)
+               return function(power_of_two_difference_rule_t{ targets });
+            return function(power_of_two_rule_t{ targets });
+         }
+         default:
+         {
+            listed_targets_t targets(config.targets == target_kind_t::powers_of_three ? gen_powers_of_three(max_power)
+                                   : config.targets == target_kind_t::squares ? gen_squares(max_power)
+                                   : config.listed_targets);
+            if (targets.values.size() <= 0)
+               throw runtime_error("No targets were given.");
+            if (config.use_differences)
+               return function(listed_difference_rule_t{ move(targets) });
+            return function(listed_sum_rule_t{ move(targets) });
+         }
+      }
+   }
+
+   // Combiners being run, from which idle threads split off work once
+   // no combiner is left to start. The split combiners are kept apart
+   // since other threads may be using the original ones.
+   template <class RULE>
+   struct combiner_stealer_t
+   {
+      // Called with each split combiner, before it runs.
+      function<void(combiner_t<RULE>&, size_t)> on_split;
+
+      void started(combiner_t<RULE>& combiner)
+      {
+         lock_guard lock(steal_mutex);
+         running.push_back(&combiner);
+      }
+
+      void finished(combiner_t<RULE>& combiner)
+      {
+         lock_guard lock(steal_mutex);
+         running.erase(find(running.begin(), running.end(), &combiner));
+      }
+
+      // Split off part of the work of the running combiner with the most
+      // values left, returns null when none has any.
+      combiner_t<RULE>* steal(size_t original_count)
+      {
+         lock_guard lock(steal_mutex);
+         while (true)
+         {
+            combiner_t<RULE>* victim = nullptr;
+            for (combiner_t<RULE>* combiner : running)
+               if (combiner->remaining_values() > 0 && (!victim || combiner->remaining_values() > victim->remaining_values()))
+                  victim = combiner;
+            if (!victim)
+               return nullptr;
+
+            size_t first = 0;
+            size_t end = 0;
+            if (!victim->split(first, end))
+               continue;
+
+            split_combiners.emplace_back(*victim, first, end);
+            combiner_t<RULE>& thief = split_combiners.back();
+            if (on_split)
+               on_split(thief, original_count + split_combiners.size() - 1);
+            running.push_back(&thief);
+            return &thief;
+         }
+      }
+
+      list<combiner_t<RULE>> split_combiners;
+
+   private:
+      mutex steal_mutex;
+      vector<combiner_t<RULE>*> running;
+   };
+
+   // Run the combiners in multiple threads and return the best result.
+   // With statistics, the combiners are run in the order they learn.
+   // The combiners split off by idle threads are added to the others.
+   template <class RULE>
+   number_set_t run_combiners_in_threads(vector<combiner_t<RULE>>& combiners, thread_pool_t& pool, const search_callbacks_t& callbacks, bool deterministic, const seed_statistics_t* statistics, combiner_stealer_t<RULE>& stealer)
+   {
+      if (combiners.size() <= 0)
+         return number_set_t(0);
+
+      atomic<size_t> next_to_do = 0;
+      learned_order_t learned_order(statistics ? combiners.size() : 0);
+      auto score = [&](size_t which) { return statistics->score(combiners[which].preset_indices); };
+      duration_t duration;
+      mutex progress_mutex;
+      search_progress_t progress;
+      progress.total_combiners = combiners.size();
+
+      pool.run_on_all_threads([&](size_t)
+      {
+         // The combiners run by the thread share the pair counts, so that
+         // each only updates those of the numbers its sets change.
+         gain_table_t<RULE> gains(combiners[0].improver.rule, combiners[0].improver.options.max_magnitude);
+
+         while (!callbacks.stop.stop_requested())
+         {
+            const size_t which = statistics ? learned_order.next(score) : next_to_do.fetch_add(1);
+            const bool is_split = which >= combiners.size();
+            combiner_t<RULE>* combiner = is_split ? nullptr : &combiners[which];
+            if (combiner)
+               stealer.started(*combiner);
+            else
+               combiner = stealer.steal(combiners.size());
+            if (!combiner)
+               break;
+
+            combiner->combine(gains, callbacks.stop);
+            stealer.finished(*combiner);
+
+            lock_guard lock(progress_mutex);
+            if (!is_split)
+               progress.done_combiners += 1;
+            progress.best_pair_count = std::max(progress.best_pair_count, combiner->improver.best_pair_count);
+            progress.max_improvement_count = std::max(progress.max_improvement_count, combiner->improver.improvement_count);
+            progress.elapsed = duration.elapsed();
+            if (callbacks.progress)
+               callbacks.progress(progress);
+
+            if (pool.should_yield())
+               break;
+         }
+      });
+
+      const phase_scope_t phase(search_phase_t::reduction);
+
+      for (combiner_t<RULE>& combiner : stealer.split_combiners)
+         combiners.push_back(move(combiner));
+      stealer.split_combiners.clear();
+
+      number_set_t best_number_set(combiners[0].number_set_size);
+      size_t best_pair_count = 0;
+      for (const combiner_t<RULE>& combiner : combiners)
+      {
+         const bool is_better = deterministic
+            ? is_canonically_better(combiner.improver.best_number_set, combiner.improver.best_pair_count, best_number_set, best_pair_count, RULE::can_simplify)
+            : combiner.improver.best_pair_count > best_pair_count;
+         if (is_better)
+         {
+            best_number_set = combiner.improver.best_number_set;
+            best_pair_count = combiner.improver.best_pair_count;
+         }
+      }
+
+      if (RULE::can_simplify)
+         best_number_set.simplify();
+      return best_number_set;
+   }
+
+   // Report the improvements of the improvers that beat all the others
+   // to the caller and publish them to the shared best number sets,
+   // both in canonical form, as the search result will be.
+   struct improvement_reporter_t
+   {
+      improvement_reporter_t(const search_callbacks_t& callbacks, shared_best_t* shared_best, size_t set_size, bool simplify)
+         : callbacks(callbacks), shared_best(shared_best), set_size(set_size), simplify(simplify) {}
+
+      // Also learn from the sets that are nearly as good as the best.
+      seed_statistics_t* statistics = nullptr;
+
+      // Make the improver report its improvements, if anyone wants them.
+      template <class IMPROVER>
+      void attach(IMPROVER& improver, const char* strategy, size_t index)
+      {
+         if (!callbacks.improvement && !shared_best && !statistics)
+            return;
+
+         improver.on_better = [this, strategy, index](const number_set_t& number_set, size_t pair_count)
+         {
+            report(number_set, pair_count, strategy, index);
+         };
+      }
+
+      void report(const number_set_t& number_set, size_t pair_count, const char* strategy, size_t index)
+      {
+         if (statistics && pair_count + 1 >= best_pair_count.load())
+            statistics->record(number_set);
+
+         // Most improvements are not global: reject them without locking.
+         if (pair_count <= best_pair_count.load())
+            return;
+
+         lock_guard lock(report_mutex);
+         if (pair_count <= best_pair_count.load())
+            return;
+         best_pair_count = pair_count;
+
+         vector<my_int_t> numbers = canonical_numbers(number_set, simplify);
+         if (shared_best)
+            shared_best->publish(numbers, pair_count);
+
+         if (!callbacks.improvement)
+            return;
+
+         search_improvement_t improvement;
+         improvement.elapsed = chrono::steady_clock::now() - start;
+         improvement.set_size = set_size;
+         improvement.pair_count = pair_count;
+         improvement.strategy = strategy;
+         improvement.combiner_index = index;
+         improvement.numbers = move(numbers);
+         callbacks.improvement(improvement);
+      }
+
+   private:
+      const search_callbacks_t& callbacks;
+      shared_best_t* shared_best;
+      const size_t set_size;
+      const bool simplify;
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      atomic<size_t> best_pair_count = 0;
+      mutex report_mutex;
+   };
+
+   // Quickly generate a reasonably good number set without any search.
+   // A non-zero max_magnitude keeps the numbers within [-max_magnitude, max_magnitude],
+   // which must hold at least number_set_size numbers.
+   template <class RULE>
+   number_set_t simple_algo(size_t number_set_size, const RULE& rule, my_int_t max_magnitude = 0)
+   {
+      auto is_allowed = [max_magnitude](my_int_t number) { return max_magnitude <= 0 || (number >= -max_magnitude && number <= max_magnitude); };
+
+      number_set_t best_number_set(number_set_size);
+      size_t best_pair_count = 0;
+      for (my_int_t min_delta_for_negative = 0; min_delta_for_negative < 20; min_delta_for_negative += 2)
+      {
+         number_set_t number_set(number_set_size);
+         for (my_int_t delta = 1; !number_set.is_filled() && is_allowed(delta); delta += 2)
+         {
+            number_set.add(delta);
+            if (delta > min_delta_for_negative && is_allowed(-delta + 2))
+               number_set.add(-delta + 2);
+         }
+
+         // Too few odd numbers are in range: fill with the others closest to zero.
+         for (my_int_t number = 0; !number_set.is_filled() && is_allowed(number); number = (number > 0 ? -number : -number + 1))
+            number_set.add(number);
+         const size_t pair_count = number_set.count_pairs(rule);
+         if (best_number_set.numbers.size() <= 0 || pair_count > best_pair_count)
+         {
+            best_number_set = number_set;
+            best_pair_count = pair_count;
+         }
+      }
+      return best_number_set;
+   }
+
+   // Search for the best number set according to the rule.
+   template <class RULE>
+   search_result_t search_with_rule(const search_config_t& config, const search_callbacks_t& callbacks, const RULE& rule)
+   {
+      duration_t duration;
+      search_result_t result;
+      improvement_reporter_t reporter(callbacks, config.shared_best, config.set_size, RULE::can_simplify);
+
+      improver_options_t improver_options;
+      improver_options.max_magnitude = config.max_magnitude;
+      improver_options.deterministic = config.deterministic;
+
+      auto improve_simple_algo = [&]()
+      {
+         number_set_t number_set = simple_algo(config.set_size, rule, config.max_magnitude);
+         improver_t<RULE> improver(rule, config.set_size, improver_options);
+         reporter.attach(improver, "simplified", 0);
+         improver.improve(number_set, callbacks.stop);
+         result.expansion_count += improver.expansion_count;
+         return improver.best_number_set;
+      };
+
+      if (config.use_simplified_algo)
+      {
+         result.best_number_set = improve_simple_algo();
+      }
+      else
+      {
+         // Generate triplets of numbers that all pair-wise form pairs.
+         vector<power_triplet_t> generated_triplets;
+         if (!config.triplets)
+         {
+            const phase_scope_t phase(search_phase_t::triplet_generation);
+            generated_triplets = generate_power_triplets(rule, config.triplet_count, config.max_magnitude);
+         }
+         const vector<power_triplet_t>& triplets = config.triplets ? *config.triplets : generated_triplets;
+         result.triplet_count = triplets.size();
+
+         // Index the numbers of the triplets to score combinations with bitmasks.
+         const triplet_universe_t universe = [&]()
+         {
+            const phase_scope_t phase(search_phase_t::triplet_generation);
+            return triplet_universe_t(triplets, rule);
+         }();
+
+         // Generate all combinations of triplets and keep the
+         // combination that has the most pairs.
+         vector<combiner_t<RULE>> combiners = [&]()
+         {
+            const phase_scope_t phase(search_phase_t::combiner_enumeration);
+            return generate_combiners(triplets, universe, rule, config.set_size, config.combiner_levels, improver_options, config.first_new_triplet);
+         }();
+         result.combiner_count = combiners.size();
+
+         unique_ptr<seed_statistics_t> statistics;
+         if (config.learn_seed_order && combiners.size() > 0)
+         {
+            statistics = make_unique<seed_statistics_t>(universe);
+            reporter.statistics = statistics.get();
+         }
+
+         combiner_stealer_t<RULE> stealer;
+         for (size_t i = 0; i < combiners.size(); ++i)
+            reporter.attach(combiners[i].improver, "combiner", i);
+         stealer.on_split = [&reporter](combiner_t<RULE>& combiner, size_t index) { reporter.attach(combiner.improver, "combiner", index); };
+
+         unique_ptr<thread_pool_t> own_pool;
+         thread_pool_t* pool = config.thread_pool;
+         if (!pool)
+         {
+            own_pool = make_unique<simple_thread_pool_t>(config.thread_count);
+            pool = own_pool.get();
+         }
+
+         result.best_number_set = run_combiners_in_threads(combiners, *pool, callbacks, config.deterministic, statistics.get(), stealer);
+
+         // Some targets, like sums of powers of three, form no triplet at all.
+         // When widening, the previous search already went through this.
+         if (combiners.size() <= 0 && config.first_new_triplet <= 0)
+            result.best_number_set = improve_simple_algo();
+
+         for (const auto& combiner : combiners)
+         {
+            result.combination_count += combiner.combination_count;
+            result.expansion_count += combiner.improver.expansion_count;
+         }
+      }
+
+      // Rebuild the set in canonical order so that even the order
+      // in which its pairs are generated is reproducible.
+      if (config.deterministic)
+      {
+         const phase_scope_t phase(search_phase_t::reduction);
+         number_set_t canonical_set(result.best_number_set.desired_size);
+         canonical_set.improvement_count = result.best_number_set.improvement_count;
+         for (const my_int_t number : canonical_numbers(result.best_number_set, RULE::can_simplify))
+            canonical_set.add(number);
+         result.best_number_set = move(canonical_set);
+      }
+
+      {
+         const phase_scope_t phase(search_phase_t::pair_counting);
+         result.pair_count = result.best_number_set.count_pairs(rule);
+      }
+      result.cancelled = callbacks.stop.stop_requested();
+      result.elapsed = duration.elapsed();
+      return result;
+   }
+}
+
+number_set_t simple_algo(size_t number_set_size)
+{
+   return simple_algo(number_set_size, power_of_two_rule_t());
+}
+
+search_result_t search(const search_config_t& config, const search_callbacks_t& callbacks)
+{
+   if (config.max_magnitude < 0 || config.max_magnitude > max_supported_magnitude)
+      throw runtime_error("The maximum magnitude must be between 0 and 2^30.");
+   if (config.max_magnitude > 0 && size_t(2 * config.max_magnitude + 1) < config.set_size)
+      throw runtime_error("The maximum magnitude is too small for the number set size.");
+
+   return with_rule(config, [&](const auto& rule) { return search_with_rule(config, callbacks, rule); });
+}
+
+vector<power_triplet_t> generate_triplets(const search_config_t& config)
+{
+   return with_rule(config, [&](const auto& rule) { return generate_power_triplets(rule, config.triplet_count, config.max_magnitude); });
+}
+
+vector<power_triplet_t> widen_triplets(const search_config_t& config, const vector<power_triplet_t>& triplets)
+{
+   // Generating more triplets finds all those found with fewer.
+   vector<power_triplet_t> widened(triplets);
+   const set<power_triplet_t> known(triplets.begin(), triplets.end());
+   for (const power_triplet_t& triplet : generate_triplets(config))
+      if (!known.contains(triplet))
+         widened.push_back(triplet);
+   return widened;
+}
+
+size_t count_pairs(const search_config_t& config, const number_set_t& number_set)
+{
+   return with_rule(config, [&](const auto& rule) { return number_set.count_pairs(rule); });
+}
+
+vector<power_pair_t> generate_pairs(const search_config_t& config, const number_set_t& number_set)
+{
+   return with_rule(config, [&](const auto& rule) { return number_set.generate_pairs(rule); });
+}
+
+void for_each_pair(const search_config_t& config, const vector<my_int_t>& numbers, const function<void(size_t, size_t)>& function)
+{
+   with_rule(config, [&](const auto& rule)
+   {
+      for (size_t i = 0; i < numbers.size(); ++i)
+         for (size_t j = i + 1; j < numbers.size(); ++j)
+            if (rule.is_pair(numbers[i], numbers[j]))
+               function(i, j);
+   });
+}
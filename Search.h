@@ -0,0 +1,154 @@
+#pragma once
+
+#include "PowerPairs.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <functional>
+#include <stop_token>
+#include <vector>
+
+struct shared_best_t;
+
+// Which values the pairs of numbers must reach.
+enum class target_kind_t
+{
+   powers_of_two,
+   powers_of_three,
+   squares,
+   listed,
+};
+
+// Parameters of a search for a number set of a given size.
+struct search_config_t
+{
+   size_t set_size = 5;
+   size_t triplet_count = 20;
+   size_t combiner_levels = 5;
+   my_int_t max_power_of_two = 9;
+   bool use_simplified_algo = false;
+
+   // Pairs reach the targets by their sum or, when use_differences is set,
+   // by their difference. Powers of three and squares go up to 2^max_power_of_two.
+   target_kind_t targets = target_kind_t::powers_of_two;
+   bool use_differences = false;
+
+   // Targets of the listed kind.
+   std::vector<my_int_t> listed_targets;
+
+   // Restrict numbers to [-max_magnitude, max_magnitude], which keeps the
+   // improvers from drifting to ever larger numbers. Zero means unbounded.
+   my_int_t max_magnitude = 0;
+
+   // Break ties canonically everywhere a best number set is chosen so that
+   // the result does not depend on the number of threads or their scheduling.
+   // A cancelled search is never deterministic.
+   bool deterministic = false;
+
+   // Learn which numbers of the triplets keep appearing in good number sets
+   // and run first the combiners whose preset triplets hold them. This finds
+   // good sets sooner, which matters when the search is stopped early.
+   bool learn_seed_order = false;
+
+   // Threads to use when no thread pool is given. Zero means all hardware threads.
+   size_t thread_count = 0;
+
+   // Optional thread pool to run the search. Not owned by the search.
+   thread_pool_t* thread_pool = nullptr;
+
+   // Optional precomputed triplets, used instead of generating
+   // triplet_count triplets. Not owned by the search.
+   const std::vector<power_triplet_t>* triplets = nullptr;
+
+   // Only search the combinations holding at least one triplet from this
+   // index on, those of the triplets before having been searched by a
+   // previous search. Used to widen the triplets of a search in steps.
+   size_t first_new_triplet = 0;
+
+   // Optional best number sets shared with other processes, which must
+   // search for the same targets. Each new best of the search is published
+   // to it when better than the shared one. Not owned by the search.
+   shared_best_t* shared_best = nullptr;
+};
+
+// Snapshot of the progress of a search.
+struct search_progress_t
+{
+   size_t done_combiners = 0;
+   size_t total_combiners = 0;
+   size_t best_pair_count = 0;
+   size_t max_improvement_count = 0;
+   std::chrono::seconds elapsed{};
+};
+
+// A new best number set of a search, found by one of its improvers.
+struct search_improvement_t
+{
+   std::chrono::nanoseconds elapsed{};
+   size_t set_size = 0;
+   size_t pair_count = 0;
+
+   // Which strategy found it: "combiner", with the index of the
+   // combiner, or "simplified".
+   const char* strategy = "";
+   size_t combiner_index = 0;
+
+   // Numbers of the set, in increasing order and canonical form.
+   std::vector<my_int_t> numbers;
+};
+
+// How the search reports to and is controlled by its caller.
+struct search_callbacks_t
+{
+   // Called each time a combiner completes. Calls are serialized,
+   // but they come from the threads running the search.
+   std::function<void(const search_progress_t&)> progress;
+
+   // Called each time the search finds a set with more pairs than all
+   // the previous ones. Calls are serialized and in increasing pair count,
+   // but they come from the threads running the search, which wait for it.
+   std::function<void(const search_improvement_t&)> improvement;
+
+   // Request cancellation through the corresponding stop_source.
+   // A cancelled search returns the best number set found so far.
+   std::stop_token stop;
+};
+
+// Outcome of a search.
+struct search_result_t
+{
+   number_set_t best_number_set{ 0 };
+   size_t pair_count = 0;
+   size_t triplet_count = 0;
+   size_t combiner_count = 0;
+   size_t combination_count = 0;
+   size_t expansion_count = 0;
+   bool cancelled = false;
+   std::chrono::seconds elapsed{};
+};
+
+// Search for the number set of the configured size with the most
+// pairs reaching the configured targets.
+search_result_t search(const search_config_t& config, const search_callbacks_t& callbacks = {});
+
+// Generate the triplets of the configured targets, as the search does.
+std::vector<power_triplet_t> generate_triplets(const search_config_t& config);
+
+// Widen the given triplets, generated for fewer triplets, to the configured
+// count: the given triplets come first, in the same order, so that the
+// combinations of them keep their indices, then the new ones.
+std::vector<power_triplet_t> widen_triplets(const search_config_t& config, const std::vector<power_triplet_t>& triplets);
+
+// Count or list the pairs of a number set according to the configured targets.
+size_t count_pairs(const search_config_t& config, const number_set_t& number_set);
+std::vector<power_pair_t> generate_pairs(const search_config_t& config, const number_set_t& number_set);
+
+// Call the function with the indices i < j of each pair of the numbers,
+// in order, without building the list of pairs.
+void for_each_pair(const search_config_t& config, const std::vector<my_int_t>& numbers, const std::function<void(size_t, size_t)>& function);
+
+// Whether number sets of the configured targets can be divided by two when all even.
+inline bool can_simplify(const search_config_t& config) { return config.targets == target_kind_t::powers_of_two; }
+
+// Quickly generate a reasonably good number set without any search.
+number_set_t simple_algo(size_t number_set_size);
@@ -0,0 +1,35 @@
+#include "SeedLearning.h"
+
+using namespace std;
+
+seed_statistics_t::seed_statistics_t(const triplet_universe_t& universe)
+   : universe(universe)
+   , frequencies(make_unique<atomic<uint64_t>[]>(universe.number_count()))
+{
+}
+
+void seed_statistics_t::record(const number_set_t& number_set)
+{
+   for (const my_int_t number : number_set.numbers)
+   {
+      const uint32_t index = universe.index_of(number);
+      if (index < universe.number_count())
+         frequencies[index].fetch_add(1, memory_order_relaxed);
+   }
+}
+
+uint64_t seed_statistics_t::score(const vector<size_t>& triplet_indices) const
+{
+   uint64_t total = 0;
+   for (const size_t triplet : triplet_indices)
+      for (size_t member = 0; member < 3; ++member)
+         total += frequencies[universe.member_index(triplet, member)].load(memory_order_relaxed);
+   return total;
+}
+
+learned_order_t::learned_order_t(size_t unit_count)
+{
+   // The next unit to hand out is at the back.
+   for (size_t unit = unit_count; unit > 0; --unit)
+      remaining.push_back(unit - 1);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "TripletUniverse.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// How often the numbers of the triplets appear in good number sets,
+// learned while a search runs. Shared by all threads of the search.
+struct seed_statistics_t
+{
+   seed_statistics_t(const triplet_universe_t& universe);
+
+   // Count the members of a good number set that are numbers of the triplets.
+   void record(const number_set_t& number_set);
+
+   // Summed frequencies of the numbers of the given triplets.
+   uint64_t score(const std::vector<size_t>& triplet_indices) const;
+
+private:
+   const triplet_universe_t& universe;
+   std::unique_ptr<std::atomic<uint64_t>[]> frequencies;
+};
+
+// Hands out work units, like combiners, to the threads of a search:
+// in their original order at first, then those that score the best,
+// rescoring the remaining ones as the statistics they use change.
+struct learned_order_t
+{
+   learned_order_t(size_t unit_count);
+
+   // Index of the next work unit, or size_t(-1) when none remain.
+   // The score function must be safe to call from any thread.
+   template <class SCORE>
+   size_t next(SCORE&& score)
+   {
+      std::lock_guard lock(mutex);
+      if (remaining.size() <= 0)
+         return size_t(-1);
+
+      if (handed_out >= std::max(min_rescore_period, remaining.size() / 16))
+      {
+         rescore(score);
+         handed_out = 0;
+      }
+
+      handed_out += 1;
+      const size_t unit = remaining.back();
+      remaining.pop_back();
+      return unit;
+   }
+
+private:
+   static constexpr size_t min_rescore_period = 64;
+
+   // Sort the remaining units so that the best is at the back. Equal
+   // scores keep the original order, so units are never starved.
+   template <class SCORE>
+   void rescore(SCORE& score)
+   {
+      scores.resize(remaining.size());
+      for (size_t i = 0; i < remaining.size(); ++i)
+         scores[i] = { score(remaining[i]), remaining[i] };
+      std::sort(scores.begin(), scores.end(), [](const auto& a, const auto& b)
+      {
+         return a.first != b.first ? a.first < b.first : a.second > b.second;
+      });
+      for (size_t i = 0; i < scores.size(); ++i)
+         remaining[i] = scores[i].second;
+   }
+
+   std::mutex mutex;
+   std::vector<size_t> remaining;
+   std::vector<std::pair<uint64_t, size_t>> scores;
+   size_t handed_out = 0;
+};
@@ -0,0 +1,320 @@
+#include "Server.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <exception>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+   // Best number set found so far for a given size.
+   struct archived_result_t
+   {
+      number_set_t number_set{ 0 };
+      size_t pair_count = 0;
+      bool complete = false;
+      chrono::milliseconds budget{};
+   };
+
+   // State kept warm between requests.
+   struct server_t
+   {
+      server_t(const server_config_t& config)
+         : config(config)
+         , pool(config.thread_count)
+         , triplets(generate_triplets(config.search))
+      {
+      }
+
+      // Handle one request line and return the reply line.
+      string handle(const string& request, stop_source& server_stop)
+      {
+         istringstream istr(request);
+         string command;
+         istr >> command;
+
+         if (command == "best")
+            return handle_best(istr, server_stop.get_token());
+         else if (command == "score")
+            return handle_score(istr);
+         else if (command != "shutdown")
+            return "error unknown request: " + command;
+
+         server_stop.request_stop();
+         return "ok";
+      }
+
+   private:
+      string handle_best(istream& istr, stop_token server_stop)
+      {
+         size_t set_size = 0;
+         double seconds = 0;
+         if (!(istr >> set_size >> seconds) || set_size < 3 || seconds < 0)
+            return "error expected: best <size> <seconds>";
+
+         const chrono::milliseconds budget(int64_t(seconds * 1000));
+
+         {
+            lock_guard lock(archive_mutex);
+            const auto pos = archive.find(set_size);
+            if (pos != archive.end())
+            {
+               const archived_result_t& archived = pos->second;
+               if (archived.complete || (budget.count() != 0 && budget <= archived.budget))
+                  return format_number_set(archived.pair_count, archived.number_set);
+            }
+         }
+
+         // Stop the search when the budget is exhausted or the server stops.
+         stop_source request_stop;
+         stop_callback server_stopped(server_stop, [&request_stop]() { request_stop.request_stop(); });
+         jthread timer;
+         if (budget.count() > 0)
+         {
+            timer = jthread([&request_stop, budget](stop_token timer_stop)
+            {
+               mutex timer_mutex;
+               condition_variable_any timer_done;
+               unique_lock lock(timer_mutex);
+               timer_done.wait_for(lock, timer_stop, budget, []() { return false; });
+               if (!timer_stop.stop_requested())
+                  request_stop.request_stop();
+            });
+         }
+
+         search_config_t search_config = config.search;
+         search_config.set_size = set_size;
+         search_config.thread_pool = &pool;
+         search_config.triplets = &triplets;
+
+         search_callbacks_t callbacks;
+         callbacks.stop = request_stop.get_token();
+
+         search_result_t result = search(search_config, callbacks);
+
+         lock_guard lock(archive_mutex);
+         archived_result_t& archived = archive[set_size];
+         const bool is_better = config.search.deterministic
+            ? is_canonically_better(result.best_number_set, result.pair_count, archived.number_set, archived.pair_count, can_simplify(config.search))
+            : result.pair_count > archived.pair_count || archived.number_set.numbers.size() <= 0;
+         if (is_better)
+         {
+            archived.number_set = result.best_number_set;
+            archived.pair_count = result.pair_count;
+         }
+         archived.complete = archived.complete || !result.cancelled;
+         archived.budget = std::max(archived.budget, budget);
+         return format_number_set(archived.pair_count, archived.number_set);
+      }
+
+      string handle_score(istream& istr)
+      {
+         number_set_t number_set(0);
+         my_int_t number;
+         while (istr >> number)
+         {
+            number_set.desired_size += 1;
+            number_set.add(number);
+         }
+         if (!istr.eof())
+            return "error expected: score <numbers...>";
+
+         return to_string(count_pairs(config.search, number_set));
+      }
+
+      static string format_number_set(size_t pair_count, const number_set_t& number_set)
+      {
+         ostringstream ostr;
+         ostr << pair_count;
+         for (const my_int_t number : set<my_int_t>(number_set.numbers.begin(), number_set.numbers.end()))
+            ostr << " " << number;
+         return ostr.str();
+      }
+
+      const server_config_t config;
+      persistent_thread_pool_t pool;
+      const vector<power_triplet_t> triplets;
+      mutex archive_mutex;
+      map<size_t, archived_result_t> archive;
+   };
+
+#ifndef _WIN32
+   // How often blocked socket operations check if the server is stopping.
+   constexpr int poll_timeout_ms = 200;
+
+   // Wait until the socket is readable or the server stops.
+   bool wait_readable(int fd, const stop_token& stop)
+   {
+      while (!stop.stop_requested())
+      {
+         pollfd pfd{ fd, POLLIN, 0 };
+         const int ready = poll(&pfd, 1, poll_timeout_ms);
+         if (ready > 0)
+            return true;
+         if (ready < 0 && errno != EINTR)
+            return false;
+      }
+      return false;
+   }
+
+   bool send_line(int fd, string line)
+   {
+      line += '\n';
+      size_t sent = 0;
+      while (sent < line.size())
+      {
+         const ssize_t count = send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+         if (count <= 0)
+            return false;
+         sent += size_t(count);
+      }
+      return true;
+   }
+
+   // Serve all requests of one client connection.
+   void serve_connection(int fd, server_t& server, stop_source& server_stop)
+   {
+      string pending;
+      char buffer[4096];
+      while (wait_readable(fd, server_stop.get_token()))
+      {
+         const ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+         if (count <= 0)
+            break;
+         pending.append(buffer, size_t(count));
+
+         size_t end_of_line;
+         while ((end_of_line = pending.find('\n')) != string::npos)
+         {
+            const string request = pending.substr(0, end_of_line);
+            pending.erase(0, end_of_line + 1);
+
+            string reply;
+            try
+            {
+               reply = server.handle(request, server_stop);
+            }
+            catch (const exception& ex)
+            {
+               reply = string("error ") + ex.what();
+            }
+
+            if (!send_line(fd, reply))
+               return;
+         }
+      }
+   }
+
+   // Client connection served in its own thread.
+   struct connection_t
+   {
+      int fd = -1;
+      atomic<bool> done = false;
+      jthread thread;
+
+      ~connection_t()
+      {
+         if (thread.joinable())
+            thread.join();
+         close(fd);
+      }
+   };
+
+   // Remove the socket left at the path by a previous server.
+   // Returns false, leaving it alone, when something else is there.
+   bool remove_socket_file(const string& path)
+   {
+      struct stat status;
+      if (lstat(path.c_str(), &status) != 0)
+         return true;
+      if (!S_ISSOCK(status.st_mode))
+         return false;
+      unlink(path.c_str());
+      return true;
+   }
+#endif
+}
+
+#ifndef _WIN32
+
+void run_server(const server_config_t& config, stop_token stop)
+{
+   sockaddr_un address{};
+   address.sun_family = AF_UNIX;
+   if (config.socket_path.size() <= 0 || config.socket_path.size() >= sizeof(address.sun_path))
+      throw runtime_error("Invalid server socket path: " + config.socket_path);
+   copy(config.socket_path.begin(), config.socket_path.end(), address.sun_path);
+
+   // Generating the triplets may fail: do it before anything needs cleaning up.
+   server_t server(config);
+
+   const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (listen_fd < 0)
+      throw runtime_error("Cannot create the server socket.");
+
+   if (!remove_socket_file(config.socket_path))
+   {
+      close(listen_fd);
+      throw runtime_error("The server socket path exists and is not a socket: " + config.socket_path);
+   }
+   if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_fd, 16) < 0)
+   {
+      close(listen_fd);
+      throw runtime_error("Cannot listen on " + config.socket_path);
+   }
+
+   stop_source server_stop;
+   stop_callback stopped(stop, [&server_stop]() { server_stop.request_stop(); });
+
+   {
+      list<connection_t> connections;
+
+      while (wait_readable(listen_fd, server_stop.get_token()))
+      {
+         const int fd = accept(listen_fd, nullptr, nullptr);
+         if (fd < 0)
+            continue;
+
+         connections.remove_if([](const connection_t& connection) { return connection.done.load(); });
+
+         connection_t& connection = connections.emplace_back();
+         connection.fd = fd;
+         connection.thread = jthread([&connection, &server, &server_stop]()
+         {
+            serve_connection(connection.fd, server, server_stop);
+            connection.done = true;
+         });
+      }
+
+      server_stop.request_stop();
+   }
+
+   close(listen_fd);
+   remove_socket_file(config.socket_path);
+}
+
+#else
+
+void run_server(const server_config_t&, stop_token)
+{
+   throw runtime_error("Server mode is only available on POSIX systems.");
+}
+
+#endif
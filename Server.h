@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Search.h"
+
+#include <stop_token>
+#include <string>
+
+// Configuration of the search server.
+struct server_config_t
+{
+   // Path of the Unix domain socket to listen on.
+   std::string socket_path;
+
+   // Threads shared by all requests. Zero means all hardware threads.
+   size_t thread_count = 0;
+
+   // Search parameters used for all requests, except the set size.
+   search_config_t search;
+};
+
+// Serve requests on a Unix domain socket until a shutdown request
+// is received or a stop is requested.
+//
+// The triplets, the thread pool and the best number set found for
+// each size are kept between requests. Requests and replies are
+// single lines of text:
+//
+//    best <size> <seconds>   ->  <pair count> <numbers...>
+//    score <numbers...>      ->  <pair count>
+//    shutdown                ->  ok
+//
+// A budget of zero seconds means to search until done. Errors are
+// replied as: error <message>
+void run_server(const server_config_t& config, std::stop_token stop = {});
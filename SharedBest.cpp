@@ -0,0 +1,168 @@
+#include "SharedBest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+struct shared_best_t::segment_t
+{
+   // Identifies the layout, so that incompatible builds do not share a segment.
+   static constexpr uint64_t layout = 0x5032505201000000ull | (max_set_size << 12) | max_numbers;
+
+   struct slot_t
+   {
+      atomic<uint64_t> sequence;
+      atomic<uint64_t> pair_count;
+      atomic<uint64_t> number_count;
+      atomic<int64_t> numbers[max_numbers];
+   };
+
+   // Zero in a new segment, all slots being zero too, thus empty.
+   atomic<uint64_t> layout_id;
+   slot_t slots[max_set_size + 1];
+
+   static_assert(atomic<uint64_t>::is_always_lock_free && atomic<int64_t>::is_always_lock_free,
+                 "Atomics in shared memory must be lock-free.");
+};
+
+namespace
+{
+   // A sequence staying odd this long means its writer died.
+   constexpr size_t max_tries = 100000;
+}
+
+shared_best_t::snapshot_t shared_best_t::read(size_t set_size) const
+{
+   snapshot_t snapshot;
+   if (set_size > max_set_size)
+      return snapshot;
+
+   const segment_t::slot_t& slot = segment->slots[set_size];
+   for (size_t tries = 0; tries < max_tries; ++tries)
+   {
+      const uint64_t before = slot.sequence.load(memory_order_acquire);
+      if (before % 2 != 0)
+      {
+         this_thread::yield();
+         continue;
+      }
+
+      snapshot.pair_count = size_t(slot.pair_count.load(memory_order_relaxed));
+      const size_t count = std::min(size_t(slot.number_count.load(memory_order_relaxed)), max_numbers);
+      snapshot.numbers.resize(count);
+      for (size_t i = 0; i < count; ++i)
+         snapshot.numbers[i] = slot.numbers[i].load(memory_order_relaxed);
+
+      atomic_thread_fence(memory_order_acquire);
+      if (slot.sequence.load(memory_order_relaxed) == before)
+         return snapshot;
+   }
+
+   return snapshot_t();
+}
+
+size_t shared_best_t::best_pair_count(size_t set_size) const
+{
+   // A single value cannot be torn: no need to check the sequence.
+   return set_size <= max_set_size ? size_t(segment->slots[set_size].pair_count.load(memory_order_acquire)) : 0;
+}
+
+bool shared_best_t::publish(const vector<my_int_t>& numbers, size_t pair_count)
+{
+   const size_t set_size = numbers.size();
+   if (set_size > max_set_size || pair_count <= best_pair_count(set_size))
+      return false;
+
+   segment_t::slot_t& slot = segment->slots[set_size];
+
+   // Lock the slot by making its sequence odd.
+   uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+   for (size_t tries = 0; ; ++tries)
+   {
+      if (tries >= max_tries)
+         return false;
+      if (sequence % 2 != 0)
+      {
+         this_thread::yield();
+         sequence = slot.sequence.load(memory_order_relaxed);
+         continue;
+      }
+      if (slot.sequence.compare_exchange_weak(sequence, sequence + 1, memory_order_acquire, memory_order_relaxed))
+         break;
+   }
+   atomic_thread_fence(memory_order_release);
+
+   // Another process may have published a better set meanwhile.
+   const bool is_better = pair_count > slot.pair_count.load(memory_order_relaxed);
+   if (is_better)
+   {
+      const size_t count = numbers.size() <= max_numbers ? numbers.size() : 0;
+
+      slot.pair_count.store(pair_count, memory_order_relaxed);
+      slot.number_count.store(count, memory_order_relaxed);
+      for (size_t i = 0; i < count; ++i)
+         slot.numbers[i].store(numbers[i], memory_order_relaxed);
+   }
+
+   // Unlock. Readers that saw the odd sequence retry.
+   slot.sequence.store(is_better ? sequence + 2 : sequence, memory_order_release);
+   return is_better;
+}
+
+#ifndef _WIN32
+
+shared_best_t::shared_best_t(const string& name)
+{
+   const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+   if (fd < 0)
+      throw runtime_error("Cannot open the shared memory " + name + ".");
+
+   // Extending the segment fills it with zeros, which are empty slots.
+   struct stat status{};
+   if (fstat(fd, &status) != 0 || (size_t(status.st_size) < sizeof(segment_t) && ftruncate(fd, sizeof(segment_t)) != 0))
+   {
+      close(fd);
+      throw runtime_error("Cannot size the shared memory " + name + ".");
+   }
+
+   void* memory = mmap(nullptr, sizeof(segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (memory == MAP_FAILED)
+      throw runtime_error("Cannot map the shared memory " + name + ".");
+   segment = static_cast<segment_t*>(memory);
+
+   uint64_t layout_id = 0;
+   if (!segment->layout_id.compare_exchange_strong(layout_id, segment_t::layout) && layout_id != segment_t::layout)
+   {
+      munmap(segment, sizeof(segment_t));
+      throw runtime_error("The shared memory " + name + " was created by an incompatible version.");
+   }
+}
+
+shared_best_t::~shared_best_t()
+{
+   munmap(segment, sizeof(segment_t));
+}
+
+#else
+
+shared_best_t::shared_best_t(const string&)
+{
+   throw runtime_error("Shared best number sets are only available on POSIX systems.");
+}
+
+shared_best_t::~shared_best_t()
+{
+}
+
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "PowerPairs.h"
+
+#include <string>
+#include <vector>
+
+// Best number set of each size, shared by all the processes of a host
+// that open the same POSIX shared-memory segment, so that concurrent
+// runs see each other's results without any network service.
+//
+// Each size has its slot protected by a seqlock: a writer makes the
+// sequence odd, writes, then makes it even again, and readers retry
+// until they see the same even sequence before and after reading.
+// Readers never block writers. A process dying while writing leaves
+// its slot locked: unlink the segment to reset it.
+struct shared_best_t
+{
+   // Largest set size with a slot.
+   static constexpr size_t max_set_size = 255;
+
+   // Larger sets only share their pair count.
+   static constexpr size_t max_numbers = 1024;
+
+   // Open the segment of the given name, like "/power-pairs",
+   // creating it if it does not exist yet.
+   shared_best_t(const std::string& name);
+   ~shared_best_t();
+
+   shared_best_t(const shared_best_t&) = delete;
+   shared_best_t& operator=(const shared_best_t&) = delete;
+
+   // Best number set of a size published by any process.
+   struct snapshot_t
+   {
+      size_t pair_count = 0;
+
+      // Empty if the set was too large to be shared.
+      std::vector<my_int_t> numbers;
+   };
+
+   snapshot_t read(size_t set_size) const;
+
+   // Only read the pair count of the best number set of a size.
+   size_t best_pair_count(size_t set_size) const;
+
+   // Publish the numbers of a set, in increasing order, if it has more
+   // pairs than the shared best of its size. Returns true when it was
+   // published. Give them in canonical form so that all processes see
+   // the same numbers for the same set.
+   bool publish(const std::vector<my_int_t>& numbers, size_t pair_count);
+
+private:
+   struct segment_t;
+
+   segment_t* segment = nullptr;
+};
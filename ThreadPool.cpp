@@ -0,0 +1,180 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+#if defined(__linux__)
+   // Pin the calling thread to the hardware thread of the given index
+   // among those the process may run on.
+   void pin_current_thread(size_t index)
+   {
+      cpu_set_t allowed;
+      if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) <= 0)
+         return;
+
+      size_t which = index % size_t(CPU_COUNT(&allowed));
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      {
+         if (!CPU_ISSET(cpu, &allowed))
+            continue;
+         if (which-- > 0)
+            continue;
+
+         cpu_set_t pinned;
+         CPU_ZERO(&pinned);
+         CPU_SET(cpu, &pinned);
+         pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+         return;
+      }
+   }
+
+   // Restore the affinity of the calling thread when leaving.
+   struct affinity_restorer_t
+   {
+      affinity_restorer_t() { valid = pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) == 0; }
+      ~affinity_restorer_t() { if (valid) pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved); }
+
+   private:
+      cpu_set_t saved;
+      bool valid = false;
+   };
+#else
+   void pin_current_thread(size_t) {}
+
+   struct affinity_restorer_t {};
+#endif
+}
+
+simple_thread_pool_t::simple_thread_pool_t(size_t count, bool pin_threads)
+   : count(count > 0 ? count : std::max(size_t(thread::hardware_concurrency()), size_t(1)))
+   , pin_threads(pin_threads)
+{
+}
+
+void simple_thread_pool_t::run_on_all_threads(const function<void(size_t)>& job)
+{
+   // The calling thread is only pinned for the duration of the run.
+   optional<affinity_restorer_t> restorer;
+   if (pin_threads)
+      restorer.emplace();
+
+   auto run_job = [this, &job](size_t index)
+   {
+      if (pin_threads)
+         pin_current_thread(index);
+      job(index);
+   };
+
+   // The threads are joined when leaving, even if the job throws.
+   vector<jthread> threads;
+   for (size_t i = 1; i < count; ++i)
+      threads.emplace_back(run_job, i);
+
+   // The calling thread does its share of the work.
+   run_job(0);
+}
+
+thread_local persistent_thread_pool_t::run_t* persistent_thread_pool_t::current_run = nullptr;
+
+persistent_thread_pool_t::persistent_thread_pool_t(size_t count)
+   : count(count > 0 ? count : std::max(size_t(thread::hardware_concurrency()), size_t(1)))
+{
+   // The thread calling run_on_all_threads also works on its run,
+   // so the pool itself holds one less thread.
+   for (size_t i = 1; i < this->count; ++i)
+      threads.emplace_back([this]() { work(); });
+}
+
+persistent_thread_pool_t::~persistent_thread_pool_t()
+{
+   {
+      lock_guard lock(mutex);
+      stopping = true;
+   }
+   work_available.notify_all();
+}
+
+void persistent_thread_pool_t::run_on_all_threads(const function<void(size_t)>& job)
+{
+   run_t run{ job };
+   {
+      lock_guard lock(mutex);
+      runs.push_back(&run);
+      run_count += 1;
+   }
+   work_available.notify_all();
+
+   // The calling thread does its share of the work and never yields,
+   // so when it returns all the work of the run has been taken.
+   job(0);
+
+   unique_lock lock(mutex);
+   run.exhausted = true;
+   runs.remove(&run);
+   run_count -= 1;
+   run_finished.wait(lock, [&run]() { return run.active == 0; });
+}
+
+bool persistent_thread_pool_t::should_yield() const
+{
+   if (!current_run)
+      return false;
+
+   const size_t workers = count - 1;
+   const size_t runs = std::max(run_count.load(), size_t(1));
+   const size_t fair_share = (workers + runs - 1) / runs;
+   return current_run->active > fair_share;
+}
+
+// Select the run with the fewest threads among those still having work.
+// Must be called with the mutex held.
+persistent_thread_pool_t::run_t* persistent_thread_pool_t::pick_run()
+{
+   run_t* best_run = nullptr;
+   for (run_t* run : runs)
+   {
+      if (run->exhausted || run->active + 1 >= count)
+         continue;
+      if (!best_run || run->active < best_run->active)
+         best_run = run;
+   }
+   return best_run;
+}
+
+void persistent_thread_pool_t::work()
+{
+   unique_lock lock(mutex);
+   while (true)
+   {
+      run_t* run = nullptr;
+      work_available.wait(lock, [this, &run]() { return stopping || (run = pick_run()) != nullptr; });
+      if (stopping)
+         return;
+
+      const size_t index = run->next_index++;
+      run->active += 1;
+      lock.unlock();
+
+      current_run = run;
+      run->job(index);
+      const bool yielded = should_yield();
+      current_run = nullptr;
+
+      lock.lock();
+      if (!yielded)
+         run->exhausted = true;
+      run->active -= 1;
+      run_finished.notify_all();
+   }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads on which the search runs its work.
+//
+// Can be provided by the application embedding the search so
+// that the search shares its threads instead of creating its own.
+struct thread_pool_t
+{
+   virtual ~thread_pool_t() = default;
+
+   // Number of threads that will run a job given to run_on_all_threads.
+   virtual size_t thread_count() const = 0;
+
+   // Run the job concurrently on all threads of the pool and wait
+   // for all of them to finish. The job receives the thread index.
+   virtual void run_on_all_threads(const std::function<void(size_t)>& job) = 0;
+
+   // Checked by jobs between units of work. When true, the job
+   // should return so that its thread can be given to another run.
+   // The thread that called run_on_all_threads is never asked to yield.
+   virtual bool should_yield() const { return false; }
+};
+
+// Thread pool that creates its threads each time it runs a job.
+struct simple_thread_pool_t : thread_pool_t
+{
+   // A thread count of zero means to use all hardware threads.
+   // Pinned threads always run the same thread index on the same
+   // hardware thread, so repeated runs are comparable. Pinning is
+   // only supported on Linux.
+   simple_thread_pool_t(size_t count = 0, bool pin_threads = false);
+
+   size_t thread_count() const override { return count; }
+
+   void run_on_all_threads(const std::function<void(size_t)>& job) override;
+
+private:
+   size_t count;
+   bool pin_threads;
+};
+
+// Thread pool that keeps its threads alive between runs.
+//
+// Concurrent runs share the threads evenly: a thread working
+// on a run with more than its fair share is asked to yield.
+struct persistent_thread_pool_t : thread_pool_t
+{
+   // A thread count of zero means to use all hardware threads.
+   persistent_thread_pool_t(size_t count = 0);
+   ~persistent_thread_pool_t();
+
+   size_t thread_count() const override { return count; }
+
+   void run_on_all_threads(const std::function<void(size_t)>& job) override;
+
+   bool should_yield() const override;
+
+private:
+   struct run_t
+   {
+      const std::function<void(size_t)>& job;
+      size_t next_index = 1;
+      std::atomic<size_t> active = 0;
+      bool exhausted = false;
+   };
+
+   run_t* pick_run();
+   void work();
+
+   static thread_local run_t* current_run;
+
+   const size_t count;
+   std::mutex mutex;
+   std::condition_variable work_available;
+   std::condition_variable run_finished;
+   std::list<run_t*> runs;
+   std::atomic<size_t> run_count = 0;
+   bool stopping = false;
+   std::vector<std::jthread> threads;
+};
@@ -0,0 +1,57 @@
+#include "Trace.h"
+
+using namespace std;
+
+trace_writer_t::trace_writer_t(const string& file_name)
+   : file(file_name)
+{
+   if (!file)
+      throw runtime_error("Cannot write the trace file " + file_name + ".");
+
+   writer = jthread([this](stop_token stop) { run(stop); });
+}
+
+void trace_writer_t::write(search_improvement_t improvement)
+{
+   {
+      lock_guard lock(mutex);
+      pending.push_back(move(improvement));
+   }
+   queued.notify_one();
+}
+
+void trace_writer_t::run(stop_token stop)
+{
+   vector<search_improvement_t> batch;
+   while (true)
+   {
+      {
+         unique_lock lock(mutex);
+         queued.wait(lock, stop, [this]() { return pending.size() > 0; });
+         batch.swap(pending);
+      }
+
+      // When stopped, the wait returns with whatever was queued last.
+      if (batch.size() <= 0 && stop.stop_requested())
+         break;
+
+      for (const search_improvement_t& improvement : batch)
+         write_line(improvement);
+      file.flush();
+      batch.clear();
+   }
+}
+
+void trace_writer_t::write_line(const search_improvement_t& improvement)
+{
+   file << "{\"elapsed_ns\":" << improvement.elapsed.count()
+        << ",\"set_size\":" << improvement.set_size
+        << ",\"pairs\":" << improvement.pair_count
+        << ",\"strategy\":\"" << improvement.strategy << "\"";
+   if (string(improvement.strategy) == "combiner")
+      file << ",\"combiner\":" << improvement.combiner_index;
+   file << ",\"numbers\":[";
+   for (size_t i = 0; i < improvement.numbers.size(); ++i)
+      file << (i > 0 ? "," : "") << improvement.numbers[i];
+   file << "]}\n";
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Search.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Write the improvements of searches to a file as newline-delimited JSON,
+// one object per line, giving the time-to-quality curve of the searches.
+//
+// The lines are written by a background thread so that the threads of
+// the search never wait on the file. Queued improvements are all written
+// before the writer is destroyed.
+struct trace_writer_t
+{
+   trace_writer_t(const std::string& file_name);
+
+   // Queue an improvement to be written.
+   void write(search_improvement_t improvement);
+
+private:
+   void run(std::stop_token stop);
+   void write_line(const search_improvement_t& improvement);
+
+   std::ofstream file;
+   std::mutex mutex;
+   std::condition_variable_any queued;
+   std::vector<search_improvement_t> pending;
+
+   // Started last and stopped first, once the rest is ready.
+   std::jthread writer;
+};
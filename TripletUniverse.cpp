@@ -0,0 +1,94 @@
+#include "TripletUniverse.h"
+
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+template <class RULE>
+triplet_universe_t::triplet_universe_t(const vector<power_triplet_t>& triplets, const RULE& rule)
+{
+   for (const power_triplet_t& tri : triplets)
+   {
+      numbers.push_back(tri.a);
+      numbers.push_back(tri.b);
+      numbers.push_back(tri.c);
+   }
+   sort(numbers.begin(), numbers.end());
+   numbers.erase(unique(numbers.begin(), numbers.end()), numbers.end());
+
+   auto index_of = [this](my_int_t number) { return uint32_t(lower_bound(numbers.begin(), numbers.end(), number) - numbers.begin()); };
+
+   for (const power_triplet_t& tri : triplets)
+   {
+      triplet_members.push_back(index_of(tri.a));
+      triplet_members.push_back(index_of(tri.b));
+      triplet_members.push_back(index_of(tri.c));
+   }
+
+   words = (numbers.size() + 63) / 64;
+   adjacency_rows.resize(numbers.size() * words);
+   for (size_t i = 0; i < numbers.size(); ++i)
+   {
+      for (size_t j = 0; j < numbers.size(); ++j)
+      {
+         if (i != j && rule.is_pair(numbers[i], numbers[j]))
+            adjacency_rows[i * words + j / 64] |= uint64_t(1) << (j % 64);
+      }
+   }
+}
+
+template triplet_universe_t::triplet_universe_t(const vector<power_triplet_t>&, const power_of_two_rule_t&);
+template triplet_universe_t::triplet_universe_t(const vector<power_triplet_t>&, const power_of_two_difference_rule_t&);
+template triplet_universe_t::triplet_universe_t(const vector<power_triplet_t>&, const listed_sum_rule_t&);
+template triplet_universe_t::triplet_universe_t(const vector<power_triplet_t>&, const listed_difference_rule_t&);
+
+combination_scorer_t::combination_scorer_t(const triplet_universe_t& universe, size_t set_size)
+   : universe(universe)
+   , set_size(set_size)
+   , masks_after(set_size * universe.word_count())
+   , filled_after(set_size)
+   , pairs_after(set_size)
+{
+}
+
+bool combination_scorer_t::update(const vector<size_t>& indices, size_t first_changed)
+{
+   // Triplets after the last one used do not change the number set.
+   if (last_used != size_t(-1) && first_changed > last_used)
+      return false;
+
+   const size_t words = universe.word_count();
+   size_t filled = first_changed > 0 ? filled_after[first_changed - 1] : 0;
+   size_t pairs = first_changed > 0 ? pairs_after[first_changed - 1] : 0;
+
+   for (size_t pos = first_changed; pos < indices.size() && filled < set_size; ++pos)
+   {
+      uint64_t* mask = &masks_after[pos * words];
+      if (pos > 0)
+         copy(mask - words, mask, mask);
+      else
+         fill(mask, mask + words, uint64_t(0));
+
+      for (size_t m = 0; m < 3 && filled < set_size; ++m)
+      {
+         const uint32_t index = universe.member_index(indices[pos], m);
+         const uint64_t bit = uint64_t(1) << (index % 64);
+         if (mask[index / 64] & bit)
+            continue;
+
+         const uint64_t* adjacency = universe.adjacency(index);
+         for (size_t w = 0; w < words; ++w)
+            pairs += size_t(popcount(adjacency[w] & mask[w]));
+
+         mask[index / 64] |= bit;
+         filled += 1;
+      }
+
+      filled_after[pos] = filled;
+      pairs_after[pos] = pairs;
+      last_used = pos;
+   }
+
+   return true;
+}
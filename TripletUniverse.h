@@ -0,0 +1,80 @@
+#pragma once
+
+#include "PowerPairs.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// The distinct numbers of all triplets, each given an index, so that
+// combinations of triplets become bitmasks over these numbers.
+//
+// Each triplet is the 3 indices of its members. The adjacency row of
+// a number is the bitmask of the numbers it forms pairs with, according
+// to the rule, so the pairs a number forms with a set is the popcount of its row
+// restricted to the set mask.
+struct triplet_universe_t
+{
+   template <class RULE = power_of_two_rule_t>
+   triplet_universe_t(const std::vector<power_triplet_t>& triplets, const RULE& rule = RULE());
+
+   // Number of 64-bit words of a bitmask over the universe.
+   size_t word_count() const { return words; }
+
+   // Index in the universe of a member (0, 1 or 2) of a triplet.
+   uint32_t member_index(size_t triplet, size_t member) const { return triplet_members[3 * triplet + member]; }
+
+   const uint64_t* adjacency(uint32_t index) const { return &adjacency_rows[size_t(index) * words]; }
+
+   my_int_t number(uint32_t index) const { return numbers[index]; }
+
+   size_t number_count() const { return numbers.size(); }
+
+   // Index of a number in the universe, or number_count() if it is not in it.
+   uint32_t index_of(my_int_t number) const
+   {
+      const auto where = std::lower_bound(numbers.begin(), numbers.end(), number);
+      return where != numbers.end() && *where == number ? uint32_t(where - numbers.begin()) : uint32_t(numbers.size());
+   }
+
+private:
+   std::vector<my_int_t> numbers;
+   std::vector<uint32_t> triplet_members;
+   std::vector<uint64_t> adjacency_rows;
+   size_t words = 0;
+};
+
+// Incrementally score combinations of triplets.
+//
+// Members are taken in the same order as number_set_t::add() does:
+// triplets in order, skipping duplicates, until the set is filled.
+// The set mask, size and pair count after each triplet of the combination
+// are kept, so that only the triplets after the first changed index are
+// rescored.
+struct combination_scorer_t
+{
+   combination_scorer_t(const triplet_universe_t& universe, size_t set_size);
+
+   // Score the combination given by the indices of its triplets, knowing
+   // that the indices before first_changed are the same as the previous call.
+   // Returns false when the resulting number set is the same as the previous one.
+   bool update(const std::vector<size_t>& indices, size_t first_changed);
+
+   size_t pair_count() const { return last_used < pairs_after.size() ? pairs_after[last_used] : 0; }
+
+   // Position of the combination where the number set got filled, or its
+   // last position when it did not.
+   size_t last_used_position() const { return last_used; }
+
+private:
+   const triplet_universe_t& universe;
+   const size_t set_size;
+
+   // Per position of the combination: set mask, set size and pair count.
+   std::vector<uint64_t> masks_after;
+   std::vector<size_t> filled_after;
+   std::vector<size_t> pairs_after;
+
+   // Last position of the combination that contributed members.
+   size_t last_used = size_t(-1);
+};
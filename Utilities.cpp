@@ -98,6 +98,8 @@ void parse_command_line(command_line_data_t& destination, const vector<command_l
          (destination.*to_parse->count) = size_t(atol(argv[arg_index]));
       else if (to_parse->is_flag())
          (destination.*to_parse->flag) = atol(argv[arg_index]) != 0;
+      else if (to_parse->is_text())
+         (destination.*to_parse->text) = argv[arg_index];
    }
 
    destination.validate();
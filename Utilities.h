@@ -20,10 +20,12 @@ struct command_line_arg_t
    size_t command_line_data_t::* count;
    int64_t command_line_data_t::* number;
    bool command_line_data_t::* flag;
+   std::string command_line_data_t::* text = nullptr;
 
    bool is_flag() const { return flag != nullptr; }
    bool is_count() const { return count != nullptr; }
    bool is_number() const { return number != nullptr; }
+   bool is_text() const { return text != nullptr; }
 };
 
 // Helper function to convert pointer-to-member of classes derived
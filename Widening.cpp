@@ -0,0 +1,220 @@
+#include "Widening.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+namespace
+{
+   // Everything of the configuration that decides which numbers form pairs.
+   string targets_signature(const search_config_t& config)
+   {
+      ostringstream ostr;
+      switch (config.targets)
+      {
+         case target_kind_t::powers_of_two:   ostr << "2";       break;
+         case target_kind_t::powers_of_three: ostr << "3";       break;
+         case target_kind_t::squares:         ostr << "squares"; break;
+         case target_kind_t::listed:          ostr << "listed";  break;
+      }
+      ostr << (config.use_differences ? " differences " : " sums ") << config.max_power_of_two << " " << config.max_magnitude;
+      if (config.targets == target_kind_t::listed)
+         for (const my_int_t target : config.listed_targets)
+            ostr << " " << target;
+      return ostr.str();
+   }
+
+   number_set_t make_number_set(size_t set_size, const vector<my_int_t>& numbers)
+   {
+      number_set_t number_set(set_size);
+      for (const my_int_t number : numbers)
+         number_set.add(number);
+      return number_set;
+   }
+}
+
+search_result_t widen_search(const search_config_t& config, size_t triplet_step, widening_checkpoint_t& checkpoint,
+                             const search_callbacks_t& callbacks, const function<void(const widening_checkpoint_t&)>& on_step)
+{
+   duration_t duration;
+   search_result_t result;
+
+   // Each step times its improvements from its own start: time them
+   // from the start of the widening instead.
+   const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+   // A checkpoint of another set size is of no use.
+   if (checkpoint.set_size != config.set_size)
+   {
+      checkpoint = widening_checkpoint_t();
+      checkpoint.set_size = config.set_size;
+   }
+
+   number_set_t best_number_set = make_number_set(config.set_size, checkpoint.best_numbers);
+   size_t best_pair_count = checkpoint.best_numbers.size() > 0 ? count_pairs(config, best_number_set) : 0;
+   vector<power_triplet_t> triplets = checkpoint.triplets;
+   triplet_step = std::max(triplet_step, size_t(1));
+
+   while (!callbacks.stop.stop_requested())
+   {
+      search_config_t step_config = config;
+      step_config.triplet_count = std::min(checkpoint.triplets.size() + triplet_step, config.triplet_count);
+      vector<power_triplet_t> widened = widen_triplets(step_config, checkpoint.triplets);
+
+      // Either the configured count is reached or no more triplets exist.
+      if (widened.size() <= checkpoint.triplets.size())
+         break;
+
+      triplets = move(widened);
+      step_config.triplets = &triplets;
+      step_config.first_new_triplet = checkpoint.triplets.size();
+
+      // Only report what beats the previous steps.
+      search_callbacks_t step_callbacks;
+      step_callbacks.stop = callbacks.stop;
+      if (callbacks.progress)
+      {
+         step_callbacks.progress = [&callbacks, best_pair_count](const search_progress_t& progress)
+         {
+            search_progress_t widened_progress = progress;
+            widened_progress.best_pair_count = std::max(progress.best_pair_count, best_pair_count);
+            callbacks.progress(widened_progress);
+         };
+      }
+      if (callbacks.improvement)
+      {
+         step_callbacks.improvement = [&callbacks, best_pair_count, start](const search_improvement_t& improvement)
+         {
+            if (improvement.pair_count <= best_pair_count)
+               return;
+            search_improvement_t widened_improvement = improvement;
+            widened_improvement.elapsed = chrono::steady_clock::now() - start;
+            callbacks.improvement(widened_improvement);
+         };
+      }
+
+      const search_result_t step_result = search(step_config, step_callbacks);
+      result.combiner_count += step_result.combiner_count;
+      result.combination_count += step_result.combination_count;
+      result.expansion_count += step_result.expansion_count;
+
+      const bool is_better = config.deterministic
+         ? is_canonically_better(step_result.best_number_set, step_result.pair_count, best_number_set, best_pair_count, can_simplify(config))
+         : step_result.pair_count > best_pair_count || best_number_set.numbers.size() <= 0;
+      if (is_better)
+      {
+         best_number_set = step_result.best_number_set;
+         best_pair_count = step_result.pair_count;
+      }
+
+      // The combinations of a cancelled step were not all searched.
+      if (step_result.cancelled)
+         break;
+
+      checkpoint.triplets = triplets;
+      checkpoint.best_numbers.assign(best_number_set.numbers.begin(), best_number_set.numbers.end());
+      sort(checkpoint.best_numbers.begin(), checkpoint.best_numbers.end());
+      checkpoint.pair_count = best_pair_count;
+      checkpoint.combination_count += step_result.combination_count;
+      if (on_step)
+         on_step(checkpoint);
+   }
+
+   // Some targets form no triplet at all: the usual search handles them.
+   if (checkpoint.triplets.size() <= 0 && !callbacks.stop.stop_requested())
+      return search(config, callbacks);
+
+   result.best_number_set = move(best_number_set);
+   result.pair_count = best_pair_count;
+   result.triplet_count = triplets.size();
+   result.cancelled = callbacks.stop.stop_requested();
+   result.elapsed = duration.elapsed();
+   return result;
+}
+
+vector<widening_checkpoint_t> read_checkpoints(const string& file_name, const search_config_t& config)
+{
+   vector<widening_checkpoint_t> checkpoints;
+
+   ifstream file(file_name);
+   if (!file)
+      return checkpoints;
+
+   auto invalid = [&file_name](const string& line) { return runtime_error("Invalid line in the checkpoint file " + file_name + ": " + line); };
+
+   string line;
+   while (getline(file, line))
+   {
+      if (line.size() <= 0 || line[0] == '#')
+         continue;
+
+      istringstream istr(line);
+      string keyword;
+      istr >> keyword;
+      if (keyword == "targets")
+      {
+         string signature;
+         getline(istr >> ws, signature);
+         if (signature != targets_signature(config))
+            throw runtime_error("The checkpoint file " + file_name + " is for other targets: " + signature);
+      }
+      else if (keyword == "set")
+      {
+         widening_checkpoint_t checkpoint;
+         size_t triplet_count = 0;
+         if (!(istr >> checkpoint.set_size >> checkpoint.pair_count >> checkpoint.combination_count >> triplet_count))
+            throw invalid(line);
+         for (size_t i = 0; i < triplet_count; ++i)
+         {
+            my_int_t a = 0, b = 0, c = 0;
+            if (!(istr >> a >> b >> c))
+               throw invalid(line);
+            checkpoint.triplets.emplace_back(a, b, c);
+         }
+         my_int_t number = 0;
+         while (istr >> number)
+            checkpoint.best_numbers.push_back(number);
+         if (!istr.eof())
+            throw invalid(line);
+         checkpoints.push_back(move(checkpoint));
+      }
+      else
+      {
+         throw invalid(line);
+      }
+   }
+   return checkpoints;
+}
+
+void write_checkpoints(const string& file_name, const vector<widening_checkpoint_t>& checkpoints, const search_config_t& config)
+{
+   // Write a new file then replace the old one, so that an interrupted
+   // write never loses the previous checkpoints.
+   const string temporary_name = file_name + ".tmp";
+   {
+      ofstream file(temporary_name);
+      if (!file)
+         throw runtime_error("Cannot write the checkpoint file " + temporary_name + ".");
+
+      file << "# targets kind sums-or-differences max-power max-magnitude [listed targets]" << endl;
+      file << "# set size pairs combinations triplet-count triplets... best-numbers..." << endl;
+      file << "targets " << targets_signature(config) << endl;
+      for (const widening_checkpoint_t& checkpoint : checkpoints)
+      {
+         file << "set " << checkpoint.set_size << " " << checkpoint.pair_count << " " << checkpoint.combination_count << " " << checkpoint.triplets.size();
+         for (const power_triplet_t& triplet : checkpoint.triplets)
+            file << " " << triplet.a << " " << triplet.b << " " << triplet.c;
+         for (const my_int_t number : checkpoint.best_numbers)
+            file << " " << number;
+         file << endl;
+      }
+      if (!file)
+         throw runtime_error("Cannot write the checkpoint file " + temporary_name + ".");
+   }
+   filesystem::rename(temporary_name, file_name);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Search.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Progress of a search whose triplets are widened in steps: the triplets
+// whose combinations were all searched, in the order they were added,
+// and the best number set found with them. Saved between runs so that
+// the search effort accumulates instead of being repeated.
+struct widening_checkpoint_t
+{
+   size_t set_size = 0;
+   std::vector<power_triplet_t> triplets;
+
+   // Numbers of the best set, in increasing order.
+   std::vector<my_int_t> best_numbers;
+   size_t pair_count = 0;
+
+   // Combinations tried by all the steps so far.
+   size_t combination_count = 0;
+};
+
+// Widen the triplets of the checkpoint by triplet_step at a time up to the
+// configured triplet count. Each step only searches the combinations holding
+// one of its new triplets and keeps the best number set of all the steps.
+// The checkpoint is updated after each completed step, then given to on_step.
+// Only the improvements over the previous steps are reported.
+//
+// The widened triplets keep the previous ones first, so they are not in the
+// order a search of the same triplet count generates. Since number sets are
+// filled from the triplets in order, the sets tried, and so the best set
+// found, may differ from that search, even with the same pair count.
+// Only a search given the widened triplets in the same order tries the same sets.
+search_result_t widen_search(const search_config_t& config, size_t triplet_step, widening_checkpoint_t& checkpoint,
+                             const search_callbacks_t& callbacks = {}, const std::function<void(const widening_checkpoint_t&)>& on_step = {});
+
+// The checkpoint file starts with the targets of the search, which must be
+// those of the configuration, then holds one checkpoint per set size.
+// A missing file has no checkpoints.
+std::vector<widening_checkpoint_t> read_checkpoints(const std::string& file_name, const search_config_t& config);
+void write_checkpoints(const std::string& file_name, const std::vector<widening_checkpoint_t>& checkpoints, const search_config_t& config);